@@ -0,0 +1,105 @@
+#include "answer_cache.h"
+#include "number_format.h"
+
+#include <cmath>
+#include <utility>
+
+namespace transcat
+  {
+    namespace
+      {
+        // Координата в кратчайшей точной записи: -0.0 совпадает с 0.0, все NaN — между собой
+        void AppendCoordinate(std::string &key, double value) {
+          key.push_back('\0');
+          if (std::isnan(value)) {
+            key += "nan";
+            return;
+          }
+          number_format::Append(key, value + 0.0, {number_format::FloatFormat::kShortest});
+        }
+      }
+
+    std::string MakeRequestKey(const Request &request) {
+      // Поля разделяются нулевым символом, которого нет в названиях
+      std::string key(1, static_cast<char>(request.type));
+      const auto append = [&key](std::string_view field) {
+        key.push_back('\0');
+        key += field;
+      };
+      switch (request.type) {
+        case RequestType::Bus:
+          [[fallthrough]];
+        case RequestType::Stop:
+          append(request.name);
+          break;
+        case RequestType::Map:
+          if (request.buses) {
+            append("buses");
+            for (const auto &bus: *request.buses) {
+              append(bus);
+            }
+          } else if (request.bounds) {
+            append("bbox");
+            for (const auto &corner: {request.bounds->min, request.bounds->max}) {
+              AppendCoordinate(key, corner.lat);
+              AppendCoordinate(key, corner.lng);
+            }
+          }
+          break;
+        case RequestType::Route:
+          [[fallthrough]];
+        case RequestType::DirectBuses:
+          append(request.from);
+          append(request.to);
+          break;
+        case RequestType::Autocomplete:
+          append(request.prefix);
+          append(std::to_string(request.limit));
+          append(std::to_string(request.max_edits));
+          break;
+      }
+      return key;
+    }
+
+    std::shared_ptr<const CachedAnswer> AnswerCache::Find(const std::string &key) {
+      const std::lock_guard guard(mutex_);
+      const auto it = index_.find(key);
+      if (it == index_.end()) {
+        ++misses_;
+        return nullptr;
+      }
+      ++hits_;
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->second;
+    }
+
+    void AnswerCache::Insert(const std::string &key, std::shared_ptr<const CachedAnswer> answer) {
+      const size_t answer_size = key.size() + answer->text.size();
+      if (answer_size > capacity_bytes_) {
+        return;
+      }
+      const std::lock_guard guard(mutex_);
+      if (index_.count(key) > 0) {
+        return;
+      }
+      entries_.emplace_front(key, std::move(answer));
+      index_.emplace(entries_.front().first, entries_.begin());
+      size_bytes_ += answer_size;
+      while (size_bytes_ > capacity_bytes_) {
+        const auto &oldest = entries_.back();
+        size_bytes_ -= oldest.first.size() + oldest.second->text.size();
+        index_.erase(oldest.first);
+        entries_.pop_back();
+      }
+    }
+
+    size_t AnswerCache::GetHits() const {
+      const std::lock_guard guard(mutex_);
+      return hits_;
+    }
+
+    size_t AnswerCache::GetMisses() const {
+      const std::lock_guard guard(mutex_);
+      return misses_;
+    }
+  }
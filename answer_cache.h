@@ -0,0 +1,62 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace transcat
+  {
+    /*
+     * Готовый текст ответа без значения request_id.
+     * Номер запроса вставляется на место id_offset при выводе каждого повтора
+     */
+    struct CachedAnswer {
+      std::string text;
+      size_t id_offset = 0;
+
+      std::string_view Prefix() const {
+        return std::string_view(text).substr(0, id_offset);
+      }
+      std::string_view Suffix() const {
+        return std::string_view(text).substr(id_offset);
+      }
+    };
+
+    // Ключ запроса без request_id: одинаковые по содержанию запросы дают одинаковый ответ
+    std::string MakeRequestKey(const Request &request);
+
+    /*
+     * Ограниченный по суммарному размеру ответов LRU-кеш между пакетами запросов режима serve.
+     * Методы потокобезопасны
+     */
+    class AnswerCache {
+     public:
+      explicit AnswerCache(size_t capacity_bytes)
+          : capacity_bytes_(capacity_bytes) {
+      }
+
+      std::shared_ptr<const CachedAnswer> Find(const std::string &key);
+      void Insert(const std::string &key, std::shared_ptr<const CachedAnswer> answer);
+
+      size_t GetHits() const;
+      size_t GetMisses() const;
+
+     private:
+      using Entry = std::pair<std::string, std::shared_ptr<const CachedAnswer>>;
+
+      mutable std::mutex mutex_;
+      size_t capacity_bytes_;
+      size_t size_bytes_ = 0;
+      size_t hits_ = 0;
+      size_t misses_ = 0;
+      // Недавно использованные записи в начале списка
+      std::list<Entry> entries_;
+      std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+    };
+  }
@@ -0,0 +1,150 @@
+#include "base_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace transcat
+  {
+    namespace base_file
+      {
+        using namespace std::literals;
+
+        namespace
+          {
+            size_t AlignUp(size_t offset) {
+              return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+            }
+
+            // Закрывает дескриптор при выходе из конструктора MappedFile, отображение остаётся действительным
+            class FileDescriptor {
+             public:
+              explicit FileDescriptor(int fd)
+                  : fd_(fd) {
+              }
+              FileDescriptor(const FileDescriptor &) = delete;
+              FileDescriptor &operator=(const FileDescriptor &) = delete;
+              ~FileDescriptor() {
+                if (fd_ >= 0) {
+                  ::close(fd_);
+                }
+              }
+              int Get() const {
+                return fd_;
+              }
+             private:
+              int fd_;
+            };
+          }
+
+        bool IsMappedBase(const std::string &file_name) {
+          std::ifstream file(file_name, std::ios::binary);
+          char magic[sizeof(kMagic)] = {};
+          return file.read(magic, sizeof(magic)) && std::equal(std::begin(magic), std::end(magic), kMagic);
+        }
+
+        void Writer::AddSection(SectionId id, const void *data, size_t size) {
+          sections_.push_back({id, std::string(static_cast<const char *>(data), size)});
+        }
+
+        void Writer::Write(std::ostream &out) const {
+          Header header{};
+          std::copy(std::begin(kMagic), std::end(kMagic), header.magic);
+          header.version = kVersion;
+          header.section_count = static_cast<uint32_t>(sections_.size());
+
+          std::vector<SectionEntry> entries;
+          entries.reserve(sections_.size());
+          size_t offset = AlignUp(sizeof(Header) + sizeof(SectionEntry) * sections_.size());
+          for (const auto &section: sections_) {
+            entries.push_back({section.id, 0, offset, section.data.size()});
+            offset = AlignUp(offset + section.data.size());
+          }
+
+          std::string file(offset, '\0');
+          std::memcpy(file.data(), &header, sizeof(header));
+          std::memcpy(file.data() + sizeof(header), entries.data(), sizeof(SectionEntry) * entries.size());
+          for (size_t i = 0; i < sections_.size(); ++i) {
+            std::copy(sections_[i].data.begin(), sections_[i].data.end(), file.begin() + entries[i].offset);
+          }
+          out.write(file.data(), static_cast<std::streamsize>(file.size()));
+        }
+
+        MappedFile::MappedFile(const std::string &file_name) {
+          const FileDescriptor fd(::open(file_name.c_str(), O_RDONLY));
+          if (fd.Get() < 0) {
+            throw std::system_error(errno, std::generic_category(), file_name);
+          }
+          struct stat file_stat{};
+          if (::fstat(fd.Get(), &file_stat) != 0) {
+            throw std::system_error(errno, std::generic_category(), file_name);
+          }
+          size_ = static_cast<size_t>(file_stat.st_size);
+          if (size_ < sizeof(Header)) {
+            throw std::runtime_error("Base file is too short: "s + file_name);
+          }
+          void *data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd.Get(), 0);
+          if (data == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), file_name);
+          }
+          data_ = static_cast<const char *>(data);
+
+          Header header{};
+          std::memcpy(&header, data_, sizeof(header));
+          const size_t table_end = sizeof(Header) + sizeof(SectionEntry) * size_t{header.section_count};
+          if (!std::equal(std::begin(kMagic), std::end(kMagic), header.magic) || header.version != kVersion
+              || table_end > size_) {
+            ::munmap(data, size_);
+            throw std::runtime_error("Unsupported base file: "s + file_name);
+          }
+          sections_ = reinterpret_cast<const SectionEntry *>(data_ + sizeof(Header));
+          section_count_ = header.section_count;
+          for (size_t i = 0; i < section_count_; ++i) {
+            if (sections_[i].offset > size_ || sections_[i].size > size_ - sections_[i].offset) {
+              ::munmap(data, size_);
+              throw std::runtime_error("Corrupted base file: "s + file_name);
+            }
+          }
+          strings_ = GetBytes(SectionId::Strings);
+        }
+
+        MappedFile::~MappedFile() {
+          ::munmap(const_cast<char *>(data_), size_);
+        }
+
+        const SectionEntry *MappedFile::FindSection(SectionId id) const {
+          const auto *const end = sections_ + section_count_;
+          const auto *const it = std::find_if(sections_, end, [id](const SectionEntry &entry) {
+            return entry.id == id;
+          });
+          return it == end ? nullptr : it;
+        }
+
+        bool MappedFile::HasSection(SectionId id) const {
+          return FindSection(id) != nullptr;
+        }
+
+        std::string_view MappedFile::GetBytes(SectionId id) const {
+          const auto *const section = FindSection(id);
+          if (section == nullptr) {
+            return {};
+          }
+          return {data_ + section->offset, static_cast<size_t>(section->size)};
+        }
+
+        std::string_view MappedFile::GetString(StringRef ref) const {
+          if (ref.offset > strings_.size() || ref.size > strings_.size() - ref.offset) {
+            throw std::out_of_range("String is out of the strings section");
+          }
+          return strings_.substr(ref.offset, ref.size);
+        }
+      }
+  }
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "graph.h"
+
+namespace transcat
+  {
+    namespace base_file
+      {
+        /*
+         * Двоичный формат базы для отображения в память. За заголовком следует таблица разделов,
+         * каждый раздел — массив записей фиксированного размера, выровненный по kSectionAlignment,
+         * поэтому данные читаются прямо из отображения без разбора и копирования.
+         * Числа хранятся в порядке байтов машины, на которой создана база.
+         *
+         * На месте, без копирования, читаются названия остановок и маршрутов (срезы раздела Strings),
+         * рёбра и списки смежности графа, матрица маршрутов и отрисованная карта.
+         * Ограничение: хеш-таблицы справочника (поиск по названиям, расстояния, маршруты остановок)
+         * в файле не хранятся и заполняются при загрузке по одной записи, поэтому запуск линеен
+         * по числу остановок, маршрутов и расстояний, хоть и без копирования строк и разбора сообщений.
+         * Маршрутизатор загружается при первом запросе Route и один раз проверяет индексы графа и матрицы.
+         * Матрица хранится целиком с фиксированной шириной ячеек, поэтому файл больше базы protobuf
+         */
+        inline constexpr char kMagic[8] = {'T', 'C', 'B', 'A', 'S', 'E', 'M', 'M'};
+        inline constexpr uint32_t kVersion = 2;
+        inline constexpr size_t kSectionAlignment = 64;
+
+        enum class SectionId : uint32_t {
+          Strings = 1,
+          Stops,
+          Buses,
+          BusStops,
+          Distances,
+          // Настройки хранятся сообщениями protobuf, они малы и читаются один раз
+          RenderSettings,
+          RoutingSettings,
+          GraphEdges,
+          IncidenceOffsets,
+          IncidenceEdges,
+          RouteWeights,
+          RoutePrevEdges,
+          NameNodes,
+          NameEdges,
+          RenderedMap
+        };
+
+        struct Header {
+          char magic[8];
+          uint32_t version;
+          uint32_t section_count;
+        };
+
+        struct SectionEntry {
+          SectionId id;
+          uint32_t reserved;
+          uint64_t offset;
+          uint64_t size;
+        };
+
+        // Названия — срезы раздела Strings
+        struct StringRef {
+          uint64_t offset;
+          uint64_t size;
+        };
+
+        struct StopRecord {
+          StringRef name;
+          double lat;
+          double lng;
+          // Вершина графа маршрутов, kNoVertex — остановки нет в графе
+          uint32_t vertex;
+          uint32_t reserved;
+        };
+
+        inline constexpr uint32_t kNoVertex = UINT32_MAX;
+
+        struct BusRecord {
+          StringRef name;
+          // Остановки маршрута — срез раздела BusStops с индексами в разделе Stops
+          uint32_t first_stop;
+          uint32_t stop_count;
+          uint32_t is_roundtrip;
+          uint32_t reserved;
+        };
+
+        struct DistanceRecord {
+          uint32_t from;
+          uint32_t to;
+          int32_t distance;
+        };
+
+        // Рёбра графа хранятся в том виде, в каком их держит в памяти graph::DirectedWeightedGraph
+        using EdgeRecord = graph::Edge<double>;
+        static_assert(std::is_trivially_copyable_v<EdgeRecord> && sizeof(EdgeRecord) == 32);
+
+        inline constexpr uint32_t kNoBus = graph::kNoBus;
+
+        // Матрица маршрутов: значения RoutePrevEdges для ячеек без предыдущего ребра
+        inline constexpr int32_t kNoPrevEdge = -1;
+        inline constexpr int32_t kUnreachable = -2;
+
+        struct NameNodeRecord {
+          uint32_t first_edge;
+          uint32_t edge_count;
+          uint32_t kinds;
+        };
+
+        struct NameEdgeRecord {
+          uint32_t label;
+          uint32_t child;
+        };
+
+        // Проверяет по сигнатуре, что файл записан в этом формате
+        bool IsMappedBase(const std::string &file_name);
+
+        // Собирает разделы в памяти и записывает их с заголовком и таблицей разделов
+        class Writer {
+         public:
+          void AddSection(SectionId id, const void *data, size_t size);
+
+          template<typename T>
+          void AddArray(SectionId id, const std::vector<T> &records) {
+            AddSection(id, records.data(), records.size() * sizeof(T));
+          }
+
+          void Write(std::ostream &out) const;
+
+         private:
+          struct Section {
+            SectionId id;
+            std::string data;
+          };
+
+          std::vector<Section> sections_;
+        };
+
+        /*
+         * Файл базы, отображённый в память только для чтения.
+         * Страницы подгружаются при первом обращении и разделяются процессами через страничный кеш.
+         * Указатели на данные разделов действительны, пока жив объект
+         */
+        class MappedFile {
+         public:
+          explicit MappedFile(const std::string &file_name);
+          MappedFile(const MappedFile &) = delete;
+          MappedFile &operator=(const MappedFile &) = delete;
+          ~MappedFile();
+
+          bool HasSection(SectionId id) const;
+          // Отсутствующий раздел читается как пустой
+          std::string_view GetBytes(SectionId id) const;
+          std::string_view GetString(StringRef ref) const;
+
+          template<typename T>
+          const T *GetArray(SectionId id, size_t &count) const {
+            const auto bytes = GetBytes(id);
+            count = bytes.size() / sizeof(T);
+            return reinterpret_cast<const T *>(bytes.data());
+          }
+
+         private:
+          const SectionEntry *FindSection(SectionId id) const;
+
+          const char *data_ = nullptr;
+          size_t size_ = 0;
+          const SectionEntry *sections_ = nullptr;
+          size_t section_count_ = 0;
+          std::string_view strings_;
+        };
+      }
+  }
@@ -1,21 +1,27 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <optional>
 #include <set>
 #include <string>
 #include <string_view>
 #include <unordered_map>
 #include <utility>
-#include <variant>
 #include <vector>
 
 #include "geo.h"
 
 namespace transcat
   {
+    /*
+     * Названия остановок и маршрутов не принадлежат объектам: они указывают в память, которую хранит
+     * справочник (TransportCatalogue::StoreName) или которой он продлевает жизнь (KeepAlive)
+     */
     struct Stop {
-      std::string name;
+      std::string_view name;
       geo::Coordinates coords;
+      size_t id = 0;
     };
 
     struct StopHash {
@@ -56,7 +62,7 @@ namespace transcat
 
      private:
       std::hash<double> d_hasher_;
-      std::hash<std::string> s_hasher_;
+      std::hash<std::string_view> s_hasher_;
     };
 
     struct Route {
@@ -73,8 +79,9 @@ namespace transcat
     };
 
     struct Bus {
-      std::string name;
+      std::string_view name;
       Route route;
+      size_t id = 0;
     };
 
     struct BusesInfo {
@@ -96,58 +103,44 @@ namespace transcat
       size_t operator()(const std::string_view bus_name) const { return hash_type{}(bus_name); }
 
      private:
-      std::hash<std::string> s_hasher_;
-    };
-
-    enum class QueryType {
-      NewStop,
-      NewRoute
+      std::hash<std::string_view> s_hasher_;
     };
 
     enum class RequestType {
       Stop,
       Bus,
       Map,
-      Route
-    };
-
-    struct JsonInfoQuery {
-      QueryType type;
-      std::string name;
-      std::vector<std::string> route;
-      bool is_roundtrip;
-      geo::Coordinates coordinates;
-      std::vector<std::pair<std::string, int>> road_distances;
-    };
-
-    struct StopQuery{
-      std::string name;
-      geo::Coordinates coordinates;
+      Route,
+      Autocomplete,
+      DirectBuses
     };
 
-    struct BusQuery{
-      std::string name;
-      std::vector<std::string> route;
-      bool is_roundtrip;
-    };
-
-    struct RoadDistanceQuery{
-      std::string name;
-      std::vector<std::pair<std::string, int>> road_distances;
-    };
-
-    using InfoQuery = std::variant<StopQuery, BusQuery, RoadDistanceQuery>;
-
     struct Request {
       int id;
       RequestType type;
       std::string name;
       std::string from;
       std::string to;
+      std::string prefix;
+      size_t limit = 10;
+      size_t max_edits = 0;
+      // Для Map: отрисовать только область карты
+      std::optional<geo::Bounds> bounds;
+      // Для Map: отрисовать только эти маршруты, область bounds при этом не учитывается
+      std::optional<std::vector<std::string>> buses;
+    };
+
+    // Protobuf — сообщение transport_catalogue.proto, Mapped — формат base_file для отображения в память
+    enum class BaseFormat {
+      Protobuf,
+      Mapped
     };
 
     struct SerializationSettings {
       std::string file;
+      BaseFormat format = BaseFormat::Protobuf;
+      // Отрисовать карту при make_base и сохранить её в базе, чтобы запросы Map не рисовали её заново
+      bool prerender_map = false;
     };
 
     using DistancesBetweenStops = std::unordered_map<std::pair<const Stop *, const Stop *>
@@ -157,6 +150,8 @@ namespace transcat
     using Buses = std::unordered_map<std::string_view, const Bus *, BusHash, std::equal_to<>>;
     using Stops = std::unordered_map<std::string_view, const Stop *, StopHash, std::equal_to<>>;
     using PassingBuses = std::unordered_map<const Stop *, std::set<std::string_view, std::less<>>, StopHash>;
+    // Битовое множество идентификаторов маршрутов, проходящих через остановку
+    using PassingBusesBits = std::vector<uint64_t>;
 
     enum class ItemType {
       WAIT,
@@ -0,0 +1,80 @@
+#include "geo.h"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace geo
+  {
+    /*
+     * Минимумы и максимумы ищутся сразу по 4 (AVX) или 2 (SSE2) значения в регистре,
+     * в конце полосы регистров сводятся к одному значению, остаток досчитывается поэлементно
+     */
+    std::optional<Bounds> ComputeBounds(const double *lats, const double *lngs, size_t count) {
+      if (count == 0) {
+        return std::nullopt;
+      }
+      Bounds bounds{{lats[0], lngs[0]}, {lats[0], lngs[0]}};
+      size_t i = 1;
+#if defined(__AVX__)
+      if (count >= 4) {
+        __m256d min_lat = _mm256_loadu_pd(lats);
+        __m256d max_lat = min_lat;
+        __m256d min_lng = _mm256_loadu_pd(lngs);
+        __m256d max_lng = min_lng;
+        for (i = 4; i + 4 <= count; i += 4) {
+          const __m256d lat = _mm256_loadu_pd(lats + i);
+          const __m256d lng = _mm256_loadu_pd(lngs + i);
+          min_lat = _mm256_min_pd(min_lat, lat);
+          max_lat = _mm256_max_pd(max_lat, lat);
+          min_lng = _mm256_min_pd(min_lng, lng);
+          max_lng = _mm256_max_pd(max_lng, lng);
+        }
+        alignas(32) double lanes[4][4];
+        _mm256_store_pd(lanes[0], min_lat);
+        _mm256_store_pd(lanes[1], max_lat);
+        _mm256_store_pd(lanes[2], min_lng);
+        _mm256_store_pd(lanes[3], max_lng);
+        bounds.min.lat = std::min({lanes[0][0], lanes[0][1], lanes[0][2], lanes[0][3]});
+        bounds.max.lat = std::max({lanes[1][0], lanes[1][1], lanes[1][2], lanes[1][3]});
+        bounds.min.lng = std::min({lanes[2][0], lanes[2][1], lanes[2][2], lanes[2][3]});
+        bounds.max.lng = std::max({lanes[3][0], lanes[3][1], lanes[3][2], lanes[3][3]});
+      }
+#elif defined(__SSE2__)
+      if (count >= 2) {
+        __m128d min_lat = _mm_loadu_pd(lats);
+        __m128d max_lat = min_lat;
+        __m128d min_lng = _mm_loadu_pd(lngs);
+        __m128d max_lng = min_lng;
+        for (i = 2; i + 2 <= count; i += 2) {
+          const __m128d lat = _mm_loadu_pd(lats + i);
+          const __m128d lng = _mm_loadu_pd(lngs + i);
+          min_lat = _mm_min_pd(min_lat, lat);
+          max_lat = _mm_max_pd(max_lat, lat);
+          min_lng = _mm_min_pd(min_lng, lng);
+          max_lng = _mm_max_pd(max_lng, lng);
+        }
+        alignas(16) double lanes[4][2];
+        _mm_store_pd(lanes[0], min_lat);
+        _mm_store_pd(lanes[1], max_lat);
+        _mm_store_pd(lanes[2], min_lng);
+        _mm_store_pd(lanes[3], max_lng);
+        bounds.min.lat = std::min(lanes[0][0], lanes[0][1]);
+        bounds.max.lat = std::max(lanes[1][0], lanes[1][1]);
+        bounds.min.lng = std::min(lanes[2][0], lanes[2][1]);
+        bounds.max.lng = std::max(lanes[3][0], lanes[3][1]);
+      }
+#endif
+      for (; i < count; ++i) {
+        bounds.min.lat = std::min(bounds.min.lat, lats[i]);
+        bounds.max.lat = std::max(bounds.max.lat, lats[i]);
+        bounds.min.lng = std::min(bounds.min.lng, lngs[i]);
+        bounds.max.lng = std::max(bounds.max.lng, lngs[i]);
+      }
+      return bounds;
+    }
+  }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 #include <functional>
+#include <optional>
 
 namespace geo
   {
@@ -10,6 +12,23 @@ namespace geo
       double lng = 0.0;
     };
 
+    // Прямоугольная область: min — юго-западный угол, max — северо-восточный
+    struct Bounds {
+      Coordinates min;
+      Coordinates max;
+
+      bool Contains(Coordinates point) const {
+        return point.lat >= min.lat && point.lat <= max.lat && point.lng >= min.lng && point.lng <= max.lng;
+      }
+      bool Intersects(const Bounds &other) const {
+        return other.min.lat <= max.lat && other.max.lat >= min.lat
+            && other.min.lng <= max.lng && other.max.lng >= min.lng;
+      }
+    };
+
+    // Наименьшая область, содержащая точки (lats[i], lngs[i]), или nullopt для пустого набора
+    std::optional<Bounds> ComputeBounds(const double *lats, const double *lngs, size_t count);
+
     inline const double EPSILON = 1e-6;
     inline bool operator==(const Coordinates &lhs, const Coordinates &rhs) {
       return (std::abs(std::abs(lhs.lat) - std::abs(rhs.lat)) < EPSILON
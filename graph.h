@@ -2,8 +2,11 @@
 
 #include "ranges.h"
 
+#include <cstdint>
 #include <cstdlib>
-#include <string_view>
+#include <memory>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph
@@ -11,77 +14,129 @@ namespace graph
     using VertexId = size_t;
     using EdgeId = size_t;
 
+    // Значение Edge::bus у ребра, которое не принадлежит маршруту
+    inline constexpr uint32_t kNoBus = UINT32_MAX;
+
+    /*
+     * Поля фиксированной ширины: рёбра хранятся в файле базы в том же виде и читаются на месте.
+     * Маршрут и остановка отправления — идентификаторы в транспортном справочнике
+     */
     template<typename Weight>
     struct Edge {
-      VertexId from;
-      VertexId to;
+      uint32_t from;
+      uint32_t to;
       Weight weight;
-      std::string_view bus_name;
-      std::string_view stop_name;
-      size_t span_count;
+      uint32_t bus;
+      uint32_t stop;
+      uint32_t span_count;
+      uint32_t reserved = 0;
     };
 
+    /*
+     * Граф не меняется после создания. Списки смежности хранятся в формате CSR:
+     * рёбра вершины v — incidence_edges[incidence_offsets[v] .. incidence_offsets[v + 1]).
+     * Рёбра и списки лежат либо в памяти графа, либо вне его, например в отображённом файле базы
+     */
     template<typename Weight>
     class DirectedWeightedGraph {
-     private:
-      using IncidenceList = std::vector<EdgeId>;
-      using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
-
      public:
-      DirectedWeightedGraph() = default;
-      explicit DirectedWeightedGraph(size_t vertex_count);
-      EdgeId AddEdge(const Edge<Weight> &edge);
+      using IncidentEdgesRange = ranges::Range<const uint32_t *>;
+
+      DirectedWeightedGraph()
+          : DirectedWeightedGraph(0, {}) {
+      }
+      // Списки смежности собираются по рёбрам, рёбра вершины в них идут по возрастанию идентификаторов
+      DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges);
+      // Граф читает рёбра и списки смежности на месте, storage владеет их памятью
+      DirectedWeightedGraph(size_t vertex_count, const Edge<Weight> *edges, size_t edge_count,
+                            const uint32_t *incidence_offsets, const uint32_t *incidence_edges,
+                            std::shared_ptr<const void> storage)
+          : vertex_count_(vertex_count)
+          , edge_count_(edge_count)
+          , edges_(edges)
+          , incidence_offsets_(incidence_offsets)
+          , incidence_edges_(incidence_edges)
+          , storage_(std::move(storage)) {
+      }
 
-      size_t GetVertexCount() const;
-      size_t GetEdgeCount() const;
+      size_t GetVertexCount() const {
+        return vertex_count_;
+      }
+      size_t GetEdgeCount() const {
+        return edge_count_;
+      }
       const Edge<Weight> &GetEdge(EdgeId edge_id) const;
       IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
-      const std::vector<IncidenceList> &GetIncidenceLists() const {
-        return incidence_lists_;
+      // Все рёбра по порядку идентификаторов
+      const Edge<Weight> *GetEdges() const {
+        return edges_;
       }
-      void SetIncidenceLists(const std::vector<IncidenceList> &incidence_lists) {
-        incidence_lists_ = incidence_lists;
+      // Смещения списков, GetVertexCount() + 1 значений, и рёбра всех списков подряд
+      const uint32_t *GetIncidenceOffsets() const {
+        return incidence_offsets_;
       }
-      void SetEdges(const std::vector<Edge<Weight>> &edges) {
-        edges_ = edges;
+      const uint32_t *GetIncidenceEdges() const {
+        return incidence_edges_;
       }
-     private:
-      std::vector<Edge<Weight>> edges_;
-      std::vector<IncidenceList> incidence_lists_;
-    };
 
-    template<typename Weight>
-    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-        : incidence_lists_(vertex_count) {
-    }
+     private:
+      struct Storage {
+        std::vector<Edge<Weight>> edges;
+        std::vector<uint32_t> incidence_offsets;
+        std::vector<uint32_t> incidence_edges;
+      };
 
-    template<typename Weight>
-    EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight> &edge) {
-      edges_.push_back(edge);
-      const EdgeId id = edges_.size() - 1;
-      incidence_lists_.at(edge.from).push_back(id);
-      return id;
-    }
+      size_t vertex_count_ = 0;
+      size_t edge_count_ = 0;
+      const Edge<Weight> *edges_ = nullptr;
+      const uint32_t *incidence_offsets_ = nullptr;
+      const uint32_t *incidence_edges_ = nullptr;
+      std::shared_ptr<const void> storage_;
+    };
 
     template<typename Weight>
-    size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-      return incidence_lists_.size();
-    }
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges)
+        : vertex_count_(vertex_count)
+        , edge_count_(edges.size()) {
+      auto storage = std::make_shared<Storage>();
+      storage->incidence_offsets.assign(vertex_count + 1, 0);
+      for (const auto &edge: edges) {
+        if (edge.from >= vertex_count || edge.to >= vertex_count) {
+          throw std::out_of_range("Edge vertex is out of the graph");
+        }
+        ++storage->incidence_offsets[edge.from + 1];
+      }
+      for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        storage->incidence_offsets[vertex + 1] += storage->incidence_offsets[vertex];
+      }
+      storage->incidence_edges.resize(edges.size());
+      std::vector<uint32_t> next(storage->incidence_offsets.begin(), storage->incidence_offsets.end() - 1);
+      for (size_t edge_id = 0; edge_id < edges.size(); ++edge_id) {
+        storage->incidence_edges[next[edges[edge_id].from]++] = static_cast<uint32_t>(edge_id);
+      }
+      storage->edges = std::move(edges);
 
-    template<typename Weight>
-    size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const {
-      return edges_.size();
+      edges_ = storage->edges.data();
+      incidence_offsets_ = storage->incidence_offsets.data();
+      incidence_edges_ = storage->incidence_edges.data();
+      storage_ = std::move(storage);
     }
 
     template<typename Weight>
     const Edge<Weight> &DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-      return edges_.at(edge_id);
+      if (edge_id >= edge_count_) {
+        throw std::out_of_range("Edge is out of the graph");
+      }
+      return edges_[edge_id];
     }
 
     template<typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
     DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-      return ranges::AsRange(incidence_lists_.at(vertex));
+      if (vertex >= vertex_count_) {
+        throw std::out_of_range("Vertex is out of the graph");
+      }
+      return {incidence_edges_ + incidence_offsets_[vertex], incidence_edges_ + incidence_offsets_[vertex + 1]};
     }
-  }  // namespace graph
\ No newline at end of file
+  }  // namespace graph
@@ -1,233 +1,398 @@
 #include "json.h"
+#include "json_scan.h"
+#include "number_format.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
+#include <memory>
 
 namespace json {
 
     namespace {
         using namespace std::literals;
 
-        Node LoadNode(std::istream& input);
-        Node LoadString(std::istream& input);
+        bool IsSpace(char c) {
+          return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+        }
 
-        std::string LoadLiteral(std::istream& input) {
-          std::string s;
-          while (std::isalpha(input.peek())) {
-            s.push_back(static_cast<char>(input.get()));
-          }
-          return s;
+        bool IsDigit(char c) {
+          return c >= '0' && c <= '9';
         }
 
-        Node LoadArray(std::istream& input) {
-          std::vector<Node> result;
+        bool IsAlpha(char c) {
+          return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        }
 
-          for (char c; input >> c && c != ']';) {
-            if (c != ',') {
-              input.putback(c);
-            }
-            result.push_back(LoadNode(input));
-          }
-          if (!input) {
-            throw ParsingError("Array parsing error"s);
+        /*
+         * Разбирает JSON-документ, целиком лежащий в непрерывном буфере.
+         * Строки без escape-последовательностей возвращаются как string_view на буфер,
+         * строки с экранированием раскодируются во внутренний буфер scratch_ и копируются в арену.
+         * Элементы незавершённых массивов и словарей копятся в общих стеках и переносятся
+         * в арену одним блоком, когда контейнер закрыт
+         */
+        class Parser {
+         public:
+          Parser(std::string_view text, Arena &arena)
+              : pos_(text.data())
+              , end_(text.data() + text.size())
+              , arena_(arena) {
           }
-          return Node(std::move(result));
-        }
 
-        Node LoadDict(std::istream& input) {
-          Dict dict;
+          Node LoadNode() {
+            char c;
+            if (!NextChar(c)) {
+              throw ParsingError("Unexpected EOF"s);
+            }
+            switch (c) {
+              case '[':
+                return LoadArray();
+              case '{':
+                return LoadDict();
+              case '"':
+                return Node(StoreString(LoadString()));
+              case 't':
+                // Встретив t или f, переходим к попытке парсинга литералов true либо false
+                [[fallthrough]];
+              case 'f':
+                --pos_;
+                return LoadBool();
+              case 'n':
+                --pos_;
+                return LoadNull();
+              default:
+                --pos_;
+                return LoadNumber();
+            }
+          }
 
-          for (char c; input >> c && c != '}';) {
-            if (c == '"') {
-              std::string key = LoadString(input).AsString();
-              if (input >> c && c == ':') {
-                if (dict.find(key) != dict.end()) {
-                  throw ParsingError("Duplicate key '"s + key + "' have been found");
+          void ParseValue(Handler &handler) {
+            if (handler.CaptureValue()) {
+              handler.OnNode(LoadNode());
+              return;
+            }
+            char c;
+            if (!NextChar(c)) {
+              throw ParsingError("Unexpected EOF"s);
+            }
+            switch (c) {
+              case '[':
+                ParseArray(handler);
+                break;
+              case '{':
+                ParseDict(handler);
+                break;
+              case '"':
+                handler.OnString(LoadString());
+                break;
+              case 't':
+                [[fallthrough]];
+              case 'f':
+                --pos_;
+                handler.OnBool(LoadBool().AsBool());
+                break;
+              case 'n':
+                --pos_;
+                LoadNull();
+                handler.OnNull();
+                break;
+              default: {
+                --pos_;
+                const Node number = LoadNumber();
+                if (number.IsInt()) {
+                  handler.OnInt(number.AsInt());
+                } else {
+                  handler.OnDouble(number.AsDouble());
                 }
-                dict.emplace(std::move(key), LoadNode(input));
-              } else {
-                throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                break;
               }
-            } else if (c != ',') {
-              throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
             }
           }
-          if (!input) {
-            throw ParsingError("Dictionary parsing error"s);
+
+         private:
+          // Пропускает пробельные символы и считывает очередной символ, аналог input >> c
+          bool NextChar(char &c) {
+            while (pos_ != end_ && IsSpace(*pos_)) {
+              ++pos_;
+            }
+            if (pos_ == end_) {
+              return false;
+            }
+            c = *pos_++;
+            return true;
           }
-          return Node(std::move(dict));
-        }
 
-        Node LoadString(std::istream& input) {
-          auto it = std::istreambuf_iterator<char>(input);
-          auto end = std::istreambuf_iterator<char>();
-          std::string s;
-          while (true) {
-            if (it == end) {
-              throw ParsingError("String parsing error");
+          std::string_view LoadLiteral() {
+            const char *begin = pos_;
+            while (pos_ != end_ && IsAlpha(*pos_)) {
+              ++pos_;
             }
-            const char ch = *it;
-            if (ch == '"') {
-              ++it;
-              break;
-            } else if (ch == '\\') {
-              ++it;
-              if (it == end) {
-                throw ParsingError("String parsing error");
+            return {begin, static_cast<size_t>(pos_ - begin)};
+          }
+
+          Node LoadArray() {
+            const size_t begin = nodes_stack_.size();
+
+            char c;
+            bool closed = false;
+            while (NextChar(c)) {
+              if (c == ']') {
+                closed = true;
+                break;
               }
-              const char escaped_char = *(it);
-              switch (escaped_char) {
-                case 'n':
-                  s.push_back('\n');
-                  break;
-                case 't':
-                  s.push_back('\t');
-                  break;
-                case 'r':
-                  s.push_back('\r');
-                  break;
-                case '"':
-                  s.push_back('"');
-                  break;
-                case '\\':
-                  s.push_back('\\');
-                  break;
-                default:
-                  throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+              if (c != ',') {
+                --pos_;
               }
-            } else if (ch == '\n' || ch == '\r') {
-              throw ParsingError("Unexpected end of line"s);
-            } else {
-              s.push_back(ch);
+              Node node = LoadNode();
+              nodes_stack_.push_back(node);
             }
-            ++it;
+            if (!closed) {
+              throw ParsingError("Array parsing error"s);
+            }
+            const size_t size = nodes_stack_.size() - begin;
+            Node *data = arena_.AllocateArray<Node>(size);
+            std::uninitialized_copy(nodes_stack_.begin() + begin, nodes_stack_.end(), data);
+            nodes_stack_.resize(begin);
+            return Node(Array(data, size));
           }
 
-          return Node(std::move(s));
-        }
+          Node LoadDict() {
+            const size_t begin = items_stack_.size();
 
-        Node LoadBool(std::istream& input) {
-          const auto s = LoadLiteral(input);
-          if (s == "true"sv) {
-            return Node{true};
-          } else if (s == "false"sv) {
-            return Node{false};
-          } else {
-            throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+            char c;
+            bool closed = false;
+            while (NextChar(c)) {
+              if (c == '}') {
+                closed = true;
+                break;
+              }
+              if (c == '"') {
+                const std::string_view key = StoreString(LoadString());
+                if (NextChar(c) && c == ':') {
+                  Node node = LoadNode();
+                  items_stack_.emplace_back(key, node);
+                } else {
+                  throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                }
+              } else if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+              }
+            }
+            if (!closed) {
+              throw ParsingError("Dictionary parsing error"s);
+            }
+
+            const auto items_begin = items_stack_.begin() + begin;
+            std::sort(items_begin, items_stack_.end(), [](const DictItem &lhs, const DictItem &rhs) {
+              return lhs.first < rhs.first;
+            });
+            const auto duplicate = std::adjacent_find(items_begin, items_stack_.end(),
+                                                      [](const DictItem &lhs, const DictItem &rhs) {
+                                                        return lhs.first == rhs.first;
+                                                      });
+            if (duplicate != items_stack_.end()) {
+              throw ParsingError("Duplicate key '"s + std::string(duplicate->first) + "' have been found");
+            }
+            const size_t size = items_stack_.size() - begin;
+            DictItem *data = arena_.AllocateArray<DictItem>(size);
+            std::uninitialized_copy(items_begin, items_stack_.end(), data);
+            items_stack_.resize(begin);
+            return Node(Dict(data, size));
           }
-        }
 
-        Node LoadNull(std::istream& input) {
-          if (auto literal = LoadLiteral(input); literal == "null"sv) {
-            return Node{nullptr};
-          } else {
-            throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+          // Строки из буфера scratch_ переносятся в арену, остальные уже ссылаются на текст документа
+          std::string_view StoreString(std::string_view value) {
+            if (value.data() == scratch_.data()) {
+              return arena_.CopyString(value);
+            }
+            return value;
           }
-        }
 
-        Node LoadNumber(std::istream& input) {
-          std::string parsed_num;
+          void ParseArray(Handler &handler) {
+            handler.OnStartArray();
+            char c;
+            while (NextChar(c)) {
+              if (c == ']') {
+                handler.OnEndArray();
+                return;
+              }
+              if (c != ',') {
+                --pos_;
+              }
+              ParseValue(handler);
+            }
+            throw ParsingError("Array parsing error"s);
+          }
 
-          // Считывает в parsed_num очередной символ из input
-          auto read_char = [&parsed_num, &input] {
-            parsed_num += static_cast<char>(input.get());
-            if (!input) {
-              throw ParsingError("Failed to read number from stream"s);
+          void ParseDict(Handler &handler) {
+            handler.OnStartDict();
+            char c;
+            while (NextChar(c)) {
+              if (c == '}') {
+                handler.OnEndDict();
+                return;
+              }
+              if (c == '"') {
+                handler.OnKey(LoadString());
+                if (NextChar(c) && c == ':') {
+                  ParseValue(handler);
+                } else {
+                  throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                }
+              } else if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+              }
             }
-          };
+            throw ParsingError("Dictionary parsing error"s);
+          }
 
-          // Считывает одну или более цифр в parsed_num из input
-          auto read_digits = [&input, read_char] {
-            if (!std::isdigit(input.peek())) {
-              throw ParsingError("A digit is expected"s);
+          std::string_view LoadString() {
+            const char *begin = pos_;
+            pos_ = detail::FindSpecialChar(pos_, end_);
+            if (pos_ == end_) {
+              throw ParsingError("String parsing error");
             }
-            while (std::isdigit(input.peek())) {
-              read_char();
+            if (*pos_ == '"') {
+              return {begin, static_cast<size_t>(pos_++ - begin)};
             }
-          };
 
-          if (input.peek() == '-') {
-            read_char();
-          }
-          // Парсим целую часть числа
-          if (input.peek() == '0') {
-            read_char();
-            // После 0 в JSON не могут идти другие цифры
-          } else {
-            read_digits();
+            // Строка с экранированием собирается в scratch_ участками между особыми символами
+            scratch_.assign(begin, pos_);
+            while (true) {
+              if (pos_ == end_) {
+                throw ParsingError("String parsing error");
+              }
+              const char ch = *pos_;
+              if (ch == '"') {
+                ++pos_;
+                break;
+              } else if (ch == '\\') {
+                ++pos_;
+                if (pos_ == end_) {
+                  throw ParsingError("String parsing error");
+                }
+                const char escaped_char = *pos_;
+                switch (escaped_char) {
+                  case 'n':
+                    scratch_.push_back('\n');
+                    break;
+                  case 't':
+                    scratch_.push_back('\t');
+                    break;
+                  case 'r':
+                    scratch_.push_back('\r');
+                    break;
+                  case '"':
+                    scratch_.push_back('"');
+                    break;
+                  case '\\':
+                    scratch_.push_back('\\');
+                    break;
+                  default:
+                    throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                }
+                ++pos_;
+              } else {
+                throw ParsingError("Unexpected end of line"s);
+              }
+              const char *run = pos_;
+              pos_ = detail::FindSpecialChar(pos_, end_);
+              scratch_.append(run, pos_);
+            }
+            return scratch_;
           }
 
-          bool is_int = true;
-          // Парсим дробную часть числа
-          if (input.peek() == '.') {
-            read_char();
-            read_digits();
-            is_int = false;
+          Node LoadBool() {
+            const auto s = LoadLiteral();
+            if (s == "true"sv) {
+              return Node{true};
+            } else if (s == "false"sv) {
+              return Node{false};
+            } else {
+              throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+            }
           }
 
-          // Парсим экспоненциальную часть числа
-          if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-            read_char();
-            if (ch = input.peek(); ch == '+' || ch == '-') {
-              read_char();
+          Node LoadNull() {
+            if (auto literal = LoadLiteral(); literal == "null"sv) {
+              return Node{nullptr};
+            } else {
+              throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
             }
-            read_digits();
-            is_int = false;
           }
 
+          Node LoadNumber() {
+            const char *begin = pos_;
+
+            // Считывает одну или более цифр
+            auto read_digits = [this] {
+              if (pos_ == end_ || !IsDigit(*pos_)) {
+                throw ParsingError("A digit is expected"s);
+              }
+              while (pos_ != end_ && IsDigit(*pos_)) {
+                ++pos_;
+              }
+            };
+
+            if (pos_ != end_ && *pos_ == '-') {
+              ++pos_;
+            }
+            // Парсим целую часть числа
+            if (pos_ != end_ && *pos_ == '0') {
+              ++pos_;
+              // После 0 в JSON не могут идти другие цифры
+            } else {
+              read_digits();
+            }
+
+            bool is_int = true;
+            // Парсим дробную часть числа
+            if (pos_ != end_ && *pos_ == '.') {
+              ++pos_;
+              read_digits();
+              is_int = false;
+            }
+
+            // Парсим экспоненциальную часть числа
+            if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+              ++pos_;
+              if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+                ++pos_;
+              }
+              read_digits();
+              is_int = false;
+            }
 
-          try {
             if (is_int) {
-              // Сначала пробуем преобразовать строку в int
-              try {
-                return std::stoi(parsed_num);
-              } catch (...) {
-                std::cerr << "Gutttcha!!" << std::endl;
-                // В случае неудачи, например, при переполнении
-                // код ниже попробует преобразовать строку в double
+              // Сначала пробуем преобразовать строку в int,
+              // при переполнении код ниже преобразует её в double
+              int int_value = 0;
+              if (const auto[ptr, ec] = std::from_chars(begin, pos_, int_value); ec == std::errc() && ptr == pos_) {
+                return int_value;
               }
             }
-            return std::stod(parsed_num);
-          } catch (...) {
-            throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+            double double_value = 0.0;
+            if (const auto[ptr, ec] = std::from_chars(begin, pos_, double_value); ec == std::errc() && ptr == pos_) {
+              return double_value;
+            }
+            throw ParsingError("Failed to convert "s + std::string(begin, pos_) + " to number"s);
           }
-        }
 
-        Node LoadNode(std::istream& input) {
-          char c;
-          if (!(input >> c)) {
-            throw ParsingError("Unexpected EOF"s);
-          }
-          switch (c) {
-            case '[':
-              return LoadArray(input);
-            case '{':
-              return LoadDict(input);
-            case '"':
-              return LoadString(input);
-            case 't':
-              // Атрибут [[fallthrough]] (провалиться) ничего не делает, и является
-              // подсказкой компилятору и человеку, что здесь программист явно задумывал
-              // разрешить переход к инструкции следующей ветки case, а не случайно забыл
-              // написать break, return или throw.
-              // В данном случае, встретив t или f, переходим к попытке парсинга
-              // литералов true либо false
-              [[fallthrough]];
-            case 'f':
-              input.putback(c);
-              return LoadBool(input);
-            case 'n':
-              input.putback(c);
-              return LoadNull(input);
-            default:
-              input.putback(c);
-              return LoadNumber(input);
-          }
-        }
+          const char *pos_;
+          const char *end_;
+          Arena &arena_;
+          std::string scratch_;
+          std::vector<Node> nodes_stack_;
+          std::vector<DictItem> items_stack_;
+        };
 
         struct PrintContext {
           std::ostream& out;
           int indent_step = 4;
           int indent = 0;
+          bool pretty = true;
 
           void PrintIndent() const {
             for (int i = 0; i < indent; ++i) {
@@ -235,8 +400,16 @@ namespace json {
             }
           }
 
+          void PrintSeparator() const {
+            if (pretty) {
+              out << ",\n"sv;
+            } else {
+              out.put(',');
+            }
+          }
+
           PrintContext Indented() const {
-            return {out, indent_step, indent_step + indent};
+            return {out, indent_step, pretty ? indent_step + indent : 0, pretty};
           }
         };
 
@@ -247,35 +420,49 @@ namespace json {
           ctx.out << value;
         }
 
-        void PrintString(const std::string& value, std::ostream& out) {
+        void PrintString(std::string_view value, std::ostream& out) {
           out.put('"');
-          for (const char c : value) {
-            switch (c) {
+          const char* run = value.data();
+          const char* const end = run + value.size();
+          while (true) {
+            const char* special = detail::FindSpecialChar(run, end);
+            out.write(run, special - run);
+            if (special == end) {
+              break;
+            }
+            switch (*special) {
               case '\r':
                 out << "\\r"sv;
                 break;
               case '\n':
                 out << "\\n"sv;
                 break;
-              case '"':
+              default:
                 // Символы " и \ выводятся как \" или \\, соответственно
-                [[fallthrough]];
-              case '\\':
                 out.put('\\');
-                [[fallthrough]];
-              default:
-                out.put(c);
+                out.put(*special);
                 break;
             }
+            run = special + 1;
           }
           out.put('"');
         }
 
         template <>
-        void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
+        void PrintValue<std::string_view>(const std::string_view& value, const PrintContext& ctx) {
           PrintString(value, ctx.out);
         }
 
+        template <>
+        void PrintValue<int>(const int& value, const PrintContext& ctx) {
+          number_format::Write(ctx.out, value);
+        }
+
+        template <>
+        void PrintValue<double>(const double& value, const PrintContext& ctx) {
+          number_format::Write(ctx.out, value);
+        }
+
         template <>
         void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx) {
           ctx.out << "null"sv;
@@ -293,42 +480,52 @@ namespace json {
         template <>
         void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
           std::ostream& out = ctx.out;
-          out << "[\n"sv;
+          out.put('[');
+          if (ctx.pretty) {
+            out.put('\n');
+          }
           bool first = true;
           auto inner_ctx = ctx.Indented();
           for (const Node& node : nodes) {
             if (first) {
               first = false;
             } else {
-              out << ",\n"sv;
+              ctx.PrintSeparator();
             }
             inner_ctx.PrintIndent();
             PrintNode(node, inner_ctx);
           }
-          out.put('\n');
-          ctx.PrintIndent();
+          if (ctx.pretty) {
+            out.put('\n');
+            ctx.PrintIndent();
+          }
           out.put(']');
         }
 
         template <>
         void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
           std::ostream& out = ctx.out;
-          out << "{\n"sv;
+          out.put('{');
+          if (ctx.pretty) {
+            out.put('\n');
+          }
           bool first = true;
           auto inner_ctx = ctx.Indented();
           for (const auto& [key, node] : nodes) {
             if (first) {
               first = false;
             } else {
-              out << ",\n"sv;
+              ctx.PrintSeparator();
             }
             inner_ctx.PrintIndent();
             PrintString(key, ctx.out);
-            out << ": "sv;
+            out << (ctx.pretty ? ": "sv : ":"sv);
             PrintNode(node, inner_ctx);
           }
-          out.put('\n');
-          ctx.PrintIndent();
+          if (ctx.pretty) {
+            out.put('\n');
+            ctx.PrintIndent();
+          }
           out.put('}');
         }
 
@@ -342,12 +539,119 @@ namespace json {
 
       }  // namespace
 
+    namespace {
+        std::string ReadAll(std::istream& input) {
+          std::string buffer;
+          constexpr size_t kChunkSize = 1 << 16;
+          while (input) {
+            const size_t size = buffer.size();
+            buffer.resize(size + kChunkSize);
+            input.read(buffer.data() + size, kChunkSize);
+            buffer.resize(size + static_cast<size_t>(input.gcount()));
+          }
+          return buffer;
+        }
+      }  // namespace
+
+    void* Arena::Allocate(size_t size, size_t alignment) {
+      const size_t padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+      if (current_ == nullptr || padding + size > left_) {
+        const size_t block_size = std::max(next_block_size_, size + alignment);
+        // Блок не заполняется нулями: арена отдаёт память только под сразу создаваемые объекты
+        blocks_.push_back(std::unique_ptr<char[]>(new char[block_size]));
+        current_ = blocks_.back().get();
+        left_ = block_size;
+        next_block_size_ = std::min(block_size * 2, kMaxBlockSize);
+        return Allocate(size, alignment);
+      }
+      void* result = current_ + padding;
+      current_ += padding + size;
+      left_ -= padding + size;
+      return result;
+    }
+
+    std::string_view Arena::CopyString(std::string_view value) {
+      if (value.empty()) {
+        return {};
+      }
+      char* data = AllocateArray<char>(value.size());
+      std::memcpy(data, value.data(), value.size());
+      return {data, value.size()};
+    }
+
+    std::string_view Arena::Adopt(std::string buffer) {
+      buffers_.push_back(std::make_unique<std::string>(std::move(buffer)));
+      return *buffers_.back();
+    }
+
+    bool operator==(const Array& lhs, const Array& rhs) {
+      return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+    bool operator==(const Dict& lhs, const Dict& rhs) {
+      return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+    const Node& Array::at(size_t index) const {
+      using namespace std::literals;
+      if (index >= size_) {
+        throw std::out_of_range("Array index is out of range"s);
+      }
+      return data_[index];
+    }
+
+    const DictItem* Dict::find(std::string_view key) const {
+      const auto it = std::lower_bound(begin(), end(), key, [](const DictItem& item, std::string_view key) {
+        return item.first < key;
+      });
+      return (it != end() && it->first == key) ? it : end();
+    }
+
+    const Node& Dict::at(std::string_view key) const {
+      using namespace std::literals;
+      const auto it = find(key);
+      if (it == end()) {
+        throw std::out_of_range("Key '"s + std::string(key) + "' is not found"s);
+      }
+      return it->second;
+    }
+
+    Document Load(std::string text) {
+      auto arena = std::make_unique<Arena>();
+      const std::string_view buffer = arena->Adopt(std::move(text));
+      const Node root = Parser(buffer, *arena).LoadNode();
+      return Document{root, std::move(arena)};
+    }
+
     Document Load(std::istream& input) {
-      return Document{LoadNode(input)};
+      return Load(ReadAll(input));
     }
 
-    void Print(const Document& doc, std::ostream& output) {
-      PrintNode(doc.GetRoot(), PrintContext{output});
+    void Parse(std::string_view text, Handler& handler) {
+      Arena arena;
+      Parser(text, arena).ParseValue(handler);
+    }
+
+    void Parse(std::istream& input, Handler& handler) {
+      const std::string buffer = ReadAll(input);
+      Parse(std::string_view(buffer), handler);
+    }
+
+    void Print(const Document& doc, std::ostream& output, PrintFormat format) {
+      const Node& root = doc.GetRoot();
+      if (format == PrintFormat::Pretty) {
+        PrintNode(root, PrintContext{output});
+        return;
+      }
+      const PrintContext ctx{output, 0, 0, false};
+      if (format == PrintFormat::Lines && root.IsArray()) {
+        for (const Node& node : root.AsArray()) {
+          PrintNode(node, ctx);
+          output.put('\n');
+        }
+        return;
+      }
+      PrintNode(root, ctx);
     }
 
   }  // namespace json
\ No newline at end of file
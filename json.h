@@ -1,28 +1,131 @@
 #pragma once
 
 #include <iostream>
-#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace json {
 
     class Node;
-    using Dict = std::map<std::string, Node>;
-    using Array = std::vector<Node>;
+    using DictItem = std::pair<std::string_view, Node>;
 
     class ParsingError : public std::runtime_error {
      public:
       using runtime_error::runtime_error;
     };
 
+    /*
+     * Арена, в которой размещаются узлы, ключи и строки документа.
+     * Память выделяется крупными блоками и освобождается вся сразу вместе с ареной,
+     * поэтому узлы не имеют деструкторов и не владеют памятью
+     */
+    class Arena {
+     public:
+      Arena() = default;
+      Arena(const Arena&) = delete;
+      Arena& operator=(const Arena&) = delete;
+
+      void* Allocate(size_t size, size_t alignment);
+
+      template <typename T>
+      T* AllocateArray(size_t count) {
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+      }
+
+      std::string_view CopyString(std::string_view value);
+
+      // Берёт во владение буфер с исходным текстом, чтобы узлы могли ссылаться на него
+      std::string_view Adopt(std::string buffer);
+
+     private:
+      static constexpr size_t kMinBlockSize = 4096;
+      static constexpr size_t kMaxBlockSize = 1 << 20;
+
+      std::vector<std::unique_ptr<char[]>> blocks_;
+      std::vector<std::unique_ptr<std::string>> buffers_;
+      char* current_ = nullptr;
+      size_t left_ = 0;
+      size_t next_block_size_ = kMinBlockSize;
+    };
+
+    // Массив узлов, размещённый в арене
+    class Array {
+     public:
+      using value_type = Node;
+      using const_iterator = const Node*;
+
+      Array() = default;
+      Array(const Node* data, size_t size)
+          : data_(data)
+          , size_(size) {
+      }
+
+      const Node* begin() const {
+        return data_;
+      }
+      const Node* end() const;
+      size_t size() const {
+        return size_;
+      }
+      bool empty() const {
+        return size_ == 0;
+      }
+      const Node& operator[](size_t index) const;
+      const Node& at(size_t index) const;
+
+     private:
+      const Node* data_ = nullptr;
+      size_t size_ = 0;
+    };
+
+    // Словарь в виде отсортированного по ключу плоского массива пар, размещённого в арене
+    class Dict {
+     public:
+      using value_type = DictItem;
+      using const_iterator = const DictItem*;
+
+      Dict() = default;
+      Dict(const DictItem* data, size_t size)
+          : data_(data)
+          , size_(size) {
+      }
+
+      const DictItem* begin() const {
+        return data_;
+      }
+      const DictItem* end() const;
+      size_t size() const {
+        return size_;
+      }
+      bool empty() const {
+        return size_ == 0;
+      }
+      const DictItem* find(std::string_view key) const;
+      size_t count(std::string_view key) const {
+        return find(key) == end() ? 0 : 1;
+      }
+      const Node& at(std::string_view key) const;
+
+     private:
+      const DictItem* data_ = nullptr;
+      size_t size_ = 0;
+    };
+
     class Node final
-        : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+        : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string_view> {
      public:
       using variant::variant;
       using Value = variant;
 
+      // Строки в узле не хранятся, только ссылаются на арену документа
+      Node(const std::string&) = delete;
+      Node(std::string&&) = delete;
+
       bool IsInt() const {
         return std::holds_alternative<int>(*this);
       }
@@ -67,7 +170,7 @@ namespace json {
       bool IsArray() const {
         return std::holds_alternative<Array>(*this);
       }
-      Array& AsArray() {
+      const Array& AsArray() const {
         using namespace std::literals;
         if (!IsArray()) {
           throw std::logic_error("Not an array"s);
@@ -77,21 +180,21 @@ namespace json {
       }
 
       bool IsString() const {
-        return std::holds_alternative<std::string>(*this);
+        return std::holds_alternative<std::string_view>(*this);
       }
-      const std::string& AsString() const {
+      std::string_view AsString() const {
         using namespace std::literals;
         if (!IsString()) {
           throw std::logic_error("Not a string"s);
         }
 
-        return std::get<std::string>(*this);
+        return std::get<std::string_view>(*this);
       }
 
       bool IsDict() const {
         return std::holds_alternative<Dict>(*this);
       }
-      Dict& AsDict() {
+      const Dict& AsDict() const {
         using namespace std::literals;
         if (!IsDict()) {
           throw std::logic_error("Not a dict"s);
@@ -113,10 +216,38 @@ namespace json {
       return !(lhs == rhs);
     }
 
+    inline const Node* Array::end() const {
+      return data_ + size_;
+    }
+
+    inline const Node& Array::operator[](size_t index) const {
+      return data_[index];
+    }
+
+    inline const DictItem* Dict::end() const {
+      return data_ + size_;
+    }
+
+    bool operator==(const Array& lhs, const Array& rhs);
+    bool operator==(const Dict& lhs, const Dict& rhs);
+
+    inline bool operator!=(const Array& lhs, const Array& rhs) {
+      return !(lhs == rhs);
+    }
+
+    inline bool operator!=(const Dict& lhs, const Dict& rhs) {
+      return !(lhs == rhs);
+    }
+
+    /*
+     * Документ владеет ареной, в которой размещены все его узлы.
+     * Узлы, полученные из документа, действительны, пока жив документ
+     */
     class Document {
      public:
-      explicit Document(Node root)
-          : root_(std::move(root)) {
+      explicit Document(Node root, std::unique_ptr<Arena> arena = nullptr)
+          : arena_(std::move(arena))
+          , root_(root) {
       }
 
       const Node& GetRoot() const {
@@ -124,6 +255,7 @@ namespace json {
       }
 
      private:
+      std::unique_ptr<Arena> arena_;
       Node root_;
     };
 
@@ -135,8 +267,51 @@ namespace json {
       return !(lhs == rhs);
     }
 
+    // Считывает поток целиком в память и разбирает его как непрерывный буфер
     Document Load(std::istream& input);
+    // Документ берёт буфер во владение, строки без экранирования ссылаются прямо на него
+    Document Load(std::string text);
+
+    /*
+     * Обработчик событий потокового (SAX) разбора.
+     * Строки, переданные в OnKey и OnString, и узел, переданный в OnNode,
+     * действительны только до возврата из обработчика.
+     * Если CaptureValue возвращает true, очередное значение целиком загружается в Node
+     * и передаётся в OnNode вместо отдельных событий
+     */
+    class Handler {
+     public:
+      virtual ~Handler() = default;
+
+      virtual bool CaptureValue() {
+        return false;
+      }
+      virtual void OnNode(Node) {}
+      virtual void OnStartDict() {}
+      virtual void OnKey(std::string_view) {}
+      virtual void OnEndDict() {}
+      virtual void OnStartArray() {}
+      virtual void OnEndArray() {}
+      virtual void OnString(std::string_view) {}
+      virtual void OnInt(int) {}
+      virtual void OnDouble(double) {}
+      virtual void OnBool(bool) {}
+      virtual void OnNull() {}
+    };
+
+    void Parse(std::istream& input, Handler& handler);
+    void Parse(std::string_view text, Handler& handler);
+
+    /*
+     * Формат вывода: Pretty — с переносами строк и отступами, Compact — в одну строку,
+     * Lines — каждый элемент корневого массива в одну строку (NDJSON)
+     */
+    enum class PrintFormat {
+      Pretty,
+      Compact,
+      Lines
+    };
 
-    void Print(const Document& doc, std::ostream& output);
+    void Print(const Document& doc, std::ostream& output, PrintFormat format = PrintFormat::Pretty);
 
-  }  // namespace json
\ No newline at end of file
+  }  // namespace json
@@ -1,14 +1,25 @@
-#include "json_builder.h"
 #include "json_reader.h"
+#include "number_format.h"
+#include "json_writer.h"
 #include "map_renderer.h"
 #include "request_handler.h"
 #include "transport_router.h"
 #include "serialization.h"
 
+#include <algorithm>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+
 namespace detail
   {
     double AboveZero(const double d) {
@@ -32,106 +43,324 @@ namespace transcat
   {
     namespace queries
       {
-        void AddRouteDistance(const JsonInfoQuery &json_info_query, std::vector<InfoQuery> &queries_to_add) {
-          if (!json_info_query.road_distances.empty()) {
-            RoadDistanceQuery road_distance_query;
-            road_distance_query.name = json_info_query.name;
-            road_distance_query.road_distances = json_info_query.road_distances;
-            queries_to_add.push_back(std::move(road_distance_query));
+        using namespace std::literals;
+
+        /*
+         * Потоковый разбор входного документа. Остановки из base_requests сразу добавляются
+         * в транспортный справочник, остальные разделы загружаются в json::Node
+         * и передаются в section_reader.
+         * Маршруты и расстояния между остановками копятся в компактном виде и добавляются
+         * одним проходом после разбора base_requests, когда известны все остановки
+         */
+        class JsonRequestsReader final
+            : public json::Handler {
+         public:
+          using SectionReader = std::function<void(std::string_view, json::Node &)>;
+
+          JsonRequestsReader(TransportCatalogue &tc, SectionReader section_reader)
+              : tc_(tc)
+              , section_reader_(std::move(section_reader)) {
           }
-        }
 
-        void AddStop(const JsonInfoQuery &json_info_query, std::vector<InfoQuery> &queries_to_add) {
-          StopQuery stop_query;
-          stop_query.name = json_info_query.name;
-          stop_query.coordinates = json_info_query.coordinates;
-          queries_to_add.push_back(std::move(stop_query));
-        }
+          bool CaptureValue() override {
+            return depth_ == kSectionsDepth && !in_base_requests_;
+          }
 
-        void AddRoute(const JsonInfoQuery &json_info_query, std::vector<InfoQuery> &queries_to_add) {
-          BusQuery bus_query;
-          bus_query.name = json_info_query.name;
-          bus_query.is_roundtrip = json_info_query.is_roundtrip;
-          bus_query.route = json_info_query.route;
-          queries_to_add.push_back(std::move(bus_query));
-        }
+          void OnNode(json::Node node) override {
+            section_reader_(section_, node);
+          }
 
-        void AddQuery(const JsonInfoQuery &json_info_query, std::vector<InfoQuery> &queries_to_add) {
-          AddRouteDistance(json_info_query, queries_to_add);
-          if (json_info_query.type == QueryType::NewStop) {
-            AddStop(json_info_query, queries_to_add);
-          } else {
-            AddRoute(json_info_query, queries_to_add);
+          void OnStartDict() override {
+            ++depth_;
+            if (in_base_requests_ && depth_ == kRequestDepth) {
+              StartRequest();
+            }
           }
-        }
 
-        void ReadBaseRequests(json::Node &reqs, std::vector<InfoQuery> &queries_to_add) {
-          for (auto &req: reqs.AsArray()) {
-            JsonInfoQuery json_info_query;
-            for (auto&[name, value]: req.AsDict()) {
-              if (name == "type") {
-                const auto &query_type = value.AsString();
-                if (query_type == "Bus") {
-                  json_info_query.type = QueryType::NewRoute;
-                } else {
-                  json_info_query.type = QueryType::NewStop;
-                }
-              } else if (name == "name") {
-                json_info_query.name = value.AsString();
-              } else if (name == "stops") {
-                for (auto &stop: value.AsArray()) {
-                  json_info_query.route.push_back(stop.AsString());
-                }
-              } else if (name == "is_roundtrip") {
-                json_info_query.is_roundtrip = value.AsBool();
-              } else if (name == "latitude") {
-                if (value.IsPureDouble()) {
-                  json_info_query.coordinates.lat = value.AsDouble();
-                } else {
-                  json_info_query.coordinates.lat = value.AsInt();
-                }
-              } else if (name == "longitude") {
-                if (value.IsPureDouble()) {
-                  json_info_query.coordinates.lng = value.AsDouble();
-                } else {
-                  json_info_query.coordinates.lng = value.AsInt();
-                }
-              } else if (name == "road_distances") {
-                for (const auto&[stop, distance]: value.AsDict()) {
-                  json_info_query.road_distances.push_back({stop, distance.AsInt()});
-                }
+          void OnEndDict() override {
+            if (in_base_requests_ && depth_ == kRequestDepth) {
+              FinishRequest();
+            }
+            --depth_;
+          }
+
+          void OnStartArray() override {
+            ++depth_;
+          }
+
+          void OnEndArray() override {
+            if (in_base_requests_ && depth_ == kBaseRequestsDepth) {
+              in_base_requests_ = false;
+              ResolveDeferred();
+            }
+            --depth_;
+          }
+
+          void OnKey(std::string_view key) override {
+            if (depth_ == kSectionsDepth) {
+              section_ = key;
+              in_base_requests_ = (key == "base_requests"sv);
+            } else if (in_base_requests_ && depth_ == kRequestDepth) {
+              field_ = ToField(key);
+            } else if (in_base_requests_ && depth_ == kRequestDepth + 1 && field_ == Field::ROAD_DISTANCES) {
+              NextString(distance_stops_, distances_count_) = key;
+            }
+          }
+
+          void OnString(std::string_view value) override {
+            if (!in_base_requests_) {
+              return;
+            }
+            if (depth_ == kRequestDepth) {
+              if (field_ == Field::TYPE) {
+                is_bus_ = (value == "Bus"sv);
+              } else if (field_ == Field::NAME) {
+                name_ = value;
               }
+            } else if (depth_ == kRequestDepth + 1 && field_ == Field::STOPS) {
+              NextString(route_stops_, route_stops_count_) = value;
+            }
+          }
 
+          void OnInt(int value) override {
+            if (in_base_requests_ && depth_ == kRequestDepth + 1 && field_ == Field::ROAD_DISTANCES) {
+              distances_.push_back(value);
+            } else {
+              OnDouble(value);
             }
-            AddQuery(json_info_query, queries_to_add);
           }
-        }
-        void ReadStatRequests(json::Node &reqs, std::vector<Request> &requests) {
-          for (auto &req: reqs.AsArray()) {
-            Request request;
-            for (const auto&[name, value]: req.AsDict()) {
-              if (name == "type") {
-                const auto &query_type = value.AsString();
-                if (query_type == "Bus") {
-                  request.type = RequestType::Bus;
-                } else if (query_type == "Stop") {
-                  request.type = RequestType::Stop;
-                } else if (query_type == "Map") {
-                  request.type = RequestType::Map;
-                } else if (query_type == "Route") {
-                  request.type = RequestType::Route;
+
+          void OnDouble(double value) override {
+            if (in_base_requests_ && depth_ == kRequestDepth) {
+              if (field_ == Field::LATITUDE) {
+                coordinates_.lat = value;
+              } else if (field_ == Field::LONGITUDE) {
+                coordinates_.lng = value;
+              }
+            }
+          }
+
+          void OnBool(bool value) override {
+            if (in_base_requests_ && depth_ == kRequestDepth && field_ == Field::IS_ROUNDTRIP) {
+              is_roundtrip_ = value;
+            }
+          }
+
+         private:
+          enum class Field {
+            OTHER,
+            TYPE,
+            NAME,
+            LATITUDE,
+            LONGITUDE,
+            STOPS,
+            IS_ROUNDTRIP,
+            ROAD_DISTANCES
+          };
+
+          static constexpr int kSectionsDepth = 1;
+          static constexpr int kBaseRequestsDepth = 2;
+          static constexpr int kRequestDepth = 3;
+
+          static Field ToField(std::string_view key) {
+            if (key == "type"sv) {
+              return Field::TYPE;
+            } else if (key == "name"sv) {
+              return Field::NAME;
+            } else if (key == "latitude"sv) {
+              return Field::LATITUDE;
+            } else if (key == "longitude"sv) {
+              return Field::LONGITUDE;
+            } else if (key == "stops"sv) {
+              return Field::STOPS;
+            } else if (key == "is_roundtrip"sv) {
+              return Field::IS_ROUNDTRIP;
+            } else if (key == "road_distances"sv) {
+              return Field::ROAD_DISTANCES;
+            }
+            return Field::OTHER;
+          }
+
+          // Строки переиспользуются между запросами, чтобы не выделять память заново
+          static std::string &NextString(std::vector<std::string> &strings, size_t &count) {
+            if (count == strings.size()) {
+              strings.emplace_back();
+            }
+            return strings[count++];
+          }
+
+          void StartRequest() {
+            field_ = Field::OTHER;
+            is_bus_ = false;
+            is_roundtrip_ = false;
+            name_.clear();
+            coordinates_ = {};
+            route_stops_count_ = 0;
+            distances_count_ = 0;
+            distances_.clear();
+          }
+
+          void FinishRequest() {
+            if (is_bus_) {
+              auto &pending_bus = pending_buses_.emplace_back();
+              pending_bus.name = name_;
+              pending_bus.is_roundtrip = is_roundtrip_;
+              pending_bus.stops.reserve(route_stops_count_);
+              for (size_t i = 0; i < route_stops_count_; ++i) {
+                pending_bus.stops.push_back(InternStopName(route_stops_[i]));
+              }
+              return;
+            }
+
+            const Stop *stop = tc_.FindStop(name_);
+            if (stop == nullptr) {
+              Stop new_stop;
+              new_stop.name = tc_.StoreName(name_);
+              new_stop.coords = coordinates_;
+              stop = tc_.AddNewStop(new_stop);
+            }
+
+            if (distances_.size() != distances_count_) {
+              throw std::logic_error("Road distance is not an int"s);
+            }
+            for (size_t i = 0; i < distances_count_; ++i) {
+              deferred_distances_.push_back({stop, InternStopName(distance_stops_[i]), distances_[i]});
+            }
+          }
+
+          // Расстояния и маршруты добавляются после всех остановок в порядке запросов, как и раньше
+          // при загрузке из json::Document: от порядка добавления зависит нумерация вершин графа
+          // и выбор между маршрутами одинаковой длительности
+          // Названия остановок из маршрутов и расстояний хранятся по одному разу, записи ссылаются на них номером
+          uint32_t InternStopName(std::string_view name) {
+            const auto it = interned_ids_.find(name);
+            if (it != interned_ids_.end()) {
+              return it->second;
+            }
+            const auto id = static_cast<uint32_t>(interned_names_.size());
+            interned_ids_.emplace(interned_names_.emplace_back(name), id);
+            return id;
+          }
+
+          void ResolveDeferred() {
+            std::vector<const Stop *> stops(interned_names_.size());
+            for (size_t i = 0; i < interned_names_.size(); ++i) {
+              stops[i] = tc_.FindStop(interned_names_[i]);
+            }
+            for (const auto &[from_stop, to_stop, distance]: deferred_distances_) {
+              tc_.InsertStopsDistance(from_stop, stops[to_stop], distance);
+            }
+            deferred_distances_.clear();
+            for (const auto &pending_bus: pending_buses_) {
+              auto *const bus = tc_.FindCreateBus(pending_bus.name);
+              bus->route.is_roundtrip = pending_bus.is_roundtrip;
+              bus->route.stops.reserve(pending_bus.stops.size());
+              for (const auto stop_id: pending_bus.stops) {
+                // Маршрут через неописанную остановку — ошибка во входных данных, а не пропуск остановки
+                if (stops[stop_id] == nullptr) {
+                  throw std::invalid_argument("Stop '"s + interned_names_[stop_id]
+                                              + "' is used in a route but not described"s);
                 }
-              } else if (name == "name") {
-                request.name = value.AsString();
-              } else if (name == "id") {
-                request.id = value.AsInt();
-              } else if (name == "from") {
-                request.from = value.AsString();
-              } else if (name == "to") {
-                request.to = value.AsString();
+                bus->route.stops.push_back(stops[stop_id]);
+              }
+              tc_.AddPassingBus(bus);
+            }
+            pending_buses_.clear();
+            interned_ids_.clear();
+            interned_names_.clear();
+          }
+
+          struct DeferredDistance {
+            const Stop *from_stop;
+            uint32_t to_stop;
+            int distance;
+          };
+
+          struct PendingBus {
+            std::string name;
+            bool is_roundtrip;
+            std::vector<uint32_t> stops;
+          };
+
+          TransportCatalogue &tc_;
+          SectionReader section_reader_;
+          int depth_ = 0;
+          bool in_base_requests_ = false;
+          std::string section_;
+
+          Field field_ = Field::OTHER;
+          bool is_bus_ = false;
+          bool is_roundtrip_ = false;
+          std::string name_;
+          geo::Coordinates coordinates_;
+          std::vector<std::string> route_stops_;
+          size_t route_stops_count_ = 0;
+          std::vector<std::string> distance_stops_;
+          size_t distances_count_ = 0;
+          std::vector<int> distances_;
+
+          std::vector<DeferredDistance> deferred_distances_;
+          std::vector<PendingBus> pending_buses_;
+          // Адреса строк в deque не меняются при добавлении, поэтому ключи ссылаются на них
+          std::deque<std::string> interned_names_;
+          std::unordered_map<std::string_view, uint32_t> interned_ids_;
+        };
+
+        // Область {"min_lat", "min_lng", "max_lat", "max_lng"}, углы могут быть переставлены
+        geo::Bounds ReadBounds(const json::Node &node) {
+          const auto &dict = node.AsDict();
+          const auto [min_lat, max_lat] = std::minmax({dict.at("min_lat").AsDouble(), dict.at("max_lat").AsDouble()});
+          const auto [min_lng, max_lng] = std::minmax({dict.at("min_lng").AsDouble(), dict.at("max_lng").AsDouble()});
+          return {{min_lat, min_lng}, {max_lat, max_lng}};
+        }
+
+        Request ReadStatRequest(const json::Node &req) {
+          Request request;
+          for (const auto&[name, value]: req.AsDict()) {
+            if (name == "type") {
+              const auto &query_type = value.AsString();
+              if (query_type == "Bus") {
+                request.type = RequestType::Bus;
+              } else if (query_type == "Stop") {
+                request.type = RequestType::Stop;
+              } else if (query_type == "Map") {
+                request.type = RequestType::Map;
+              } else if (query_type == "Route") {
+                request.type = RequestType::Route;
+              } else if (query_type == "Autocomplete") {
+                request.type = RequestType::Autocomplete;
+              } else if (query_type == "DirectBuses") {
+                request.type = RequestType::DirectBuses;
+              }
+            } else if (name == "name") {
+              request.name = value.AsString();
+            } else if (name == "id") {
+              request.id = value.AsInt();
+            } else if (name == "from") {
+              request.from = value.AsString();
+            } else if (name == "to") {
+              request.to = value.AsString();
+            } else if (name == "prefix") {
+              request.prefix = value.AsString();
+            } else if (name == "limit") {
+              request.limit = ::detail::AboveZero(value.AsInt());
+            } else if (name == "max_edits") {
+              request.max_edits = ::detail::AboveZero(value.AsInt());
+            } else if (name == "bbox") {
+              request.bounds = ReadBounds(value);
+            } else if (name == "buses") {
+              auto &buses = request.buses.emplace();
+              for (const auto &bus: value.AsArray()) {
+                buses.emplace_back(bus.AsString());
               }
             }
-            requests.push_back(std::move(request));
+          }
+          return request;
+        }
+
+        void ReadStatRequests(const json::Node &reqs, std::vector<Request> &requests) {
+          for (const auto &req: reqs.AsArray()) {
+            requests.push_back(ReadStatRequest(req));
           }
         }
         void ReadRenderSettings(json::Node &reqs, transcat::RenderSettings &render_settings) {
@@ -162,7 +391,7 @@ namespace transcat
               }
             } else if (name == "underlayer_color") {
               if (value.IsString()) {
-                render_settings.underlayer_color = value.AsString();
+                render_settings.underlayer_color = std::string(value.AsString());
               } else if (value.IsArray() && value.AsArray().size() == 3) {
                 auto &jColor = value.AsArray();
                 svg::Rgb color(jColor[0].AsInt(), jColor[1].AsInt(), jColor[2].AsInt());
@@ -174,10 +403,19 @@ namespace transcat
               }
             } else if (name == "underlayer_width") {
               render_settings.underlayer_width = ::detail::AboveZero(value.AsDouble());
+            } else if (name == "coordinate_precision") {
+              if (value.IsString() && value.AsString() == "shortest"sv) {
+                render_settings.coordinate_precision = number_format::FloatFormat::kShortest;
+              } else {
+                render_settings.coordinate_precision =
+                    std::clamp(value.AsInt(), 1, number_format::FloatFormat::kMaxPrecision);
+              }
+            } else if (name == "simplify_tolerance") {
+              render_settings.simplify_tolerance = ::detail::AboveZero(value.AsDouble());
             } else if (name == "color_palette") {
               for (auto &color: value.AsArray()) {
                 if (color.IsString()) {
-                  render_settings.color_palette.push_back(color.AsString());
+                  render_settings.color_palette.push_back(std::string(color.AsString()));
                 } else if (color.IsArray() && color.AsArray().size() == 3) {
                   const auto &jColor = color.AsArray();
                   svg::Rgb color_to_add(jColor[0].AsInt(), jColor[1].AsInt(), jColor[2].AsInt());
@@ -206,17 +444,41 @@ namespace transcat
           for (auto&[name, value]: reqs.AsDict()) {
             if (name == "file") {
               serialization_settings.file = value.AsString();
+            } else if (name == "format") {
+              const auto format = value.AsString();
+              if (format == "protobuf"sv) {
+                serialization_settings.format = transcat::BaseFormat::Protobuf;
+              } else if (format == "mapped"sv) {
+                serialization_settings.format = transcat::BaseFormat::Mapped;
+              } else {
+                throw std::invalid_argument("Unknown base format: "s + std::string(format));
+              }
+            } else if (name == "prerender_map") {
+              serialization_settings.prerender_map = value.AsBool();
+            }
+          }
+        }
+
+        void ReadOutputSettings(json::Node &reqs, json::PrintFormat &output_format) {
+          for (auto&[name, value]: reqs.AsDict()) {
+            if (name == "format") {
+              const auto format = value.AsString();
+              if (format == "pretty"sv) {
+                output_format = json::PrintFormat::Pretty;
+              } else if (format == "compact"sv) {
+                output_format = json::PrintFormat::Compact;
+              } else if (format == "ndjson"sv) {
+                output_format = json::PrintFormat::Lines;
+              } else {
+                throw std::invalid_argument("Unknown output format: "s + std::string(format));
+              }
             }
           }
         }
 
         void QueryManager::ReadJsonRequests(std::istream &input) {
-          const auto Doc = json::Load(input);
-          auto root = Doc.GetRoot();
-          for (auto &[req_type, reqs]: root.AsDict()) {
-            if (req_type == "base_requests") {
-              ReadBaseRequests(reqs, queries_to_add_);
-            } else if (req_type == "stat_requests") {
+          JsonRequestsReader reader(tc_, [this](std::string_view req_type, json::Node &reqs) {
+            if (req_type == "stat_requests") {
               ReadStatRequests(reqs, requests_);
             } else if (req_type == "render_settings") {
               ReadRenderSettings(reqs, render_settings_);
@@ -224,129 +486,242 @@ namespace transcat
               ReadRoutingSettings(reqs, routing_settings_);
             } else if (req_type == "serialization_settings") {
               ReadSerializationSettings(reqs, serialization_settings_);
+            } else if (req_type == "output_settings" && !output_format_forced_) {
+              ReadOutputSettings(reqs, output_format_);
             }
-            AddQueriesToTC();
-          }
+          });
+          json::Parse(input, reader);
         }
 
-        void QueryManager::AddQueriesToTC() {
-          for (const auto &query: queries_to_add_) {
-            if (std::holds_alternative<StopQuery>(query)) {
-              StopQuery stop_query = std::get<StopQuery>(query);
-              Stop new_stop;
-              new_stop.name = stop_query.name;
-              new_stop.coords = stop_query.coordinates;
-              tc_.AddNewStop(new_stop);
+        void QueryManager::WriteAnswer(const Request &request, json::Writer &writer, size_t *request_id_offset) const {
+          // Для кеша значение request_id пропускается, а его место во фрагменте запоминается
+          const auto write_request_id = [&request, &writer, request_id_offset] {
+            writer.Key("request_id"sv);
+            if (request_id_offset != nullptr) {
+              writer.RawValue(std::string_view{});
+              *request_id_offset = writer.GetFragmentSize();
+              return;
             }
-          }
-          for (const auto &query: queries_to_add_) {
-            if (std::holds_alternative<RoadDistanceQuery>(query)) {
-              RoadDistanceQuery road_distance_query = std::get<RoadDistanceQuery>(query);
-              for (const auto &[to_stop, dist]: road_distance_query.road_distances) {
-                const auto *const first_stop = tc_.FindStop(road_distance_query.name);
-                const auto *const second_stop = tc_.FindStop(to_stop);
-                tc_.InsertStopsDistance(first_stop, second_stop, dist);
+            writer.Value(request.id);
+          };
+          // Ключи выводятся в алфавитном порядке, как их упорядочивает json::Dict
+          writer.StartDict();
+          switch (request.type) {
+            case RequestType::Bus: {
+              const auto &bus_name = request.name;
+              const auto route_info = tc_.ComputeRouteInfo(bus_name);
+              if (route_info.not_found) {
+                writer.Key("error_message"sv).Value("not found"sv);
+                write_request_id();
+              } else {
+                writer.Key("curvature"sv).Value(route_info.curvature);
+                write_request_id();
+                writer.Key("route_length"sv).Value(route_info.route_length);
+                writer.Key("stop_count"sv).Value(static_cast<int>(route_info.stops_on_route));
+                writer.Key("unique_stop_count"sv).Value(static_cast<int>(route_info.unique_stops));
               }
+              break;
             }
-          }
-          for (const auto &query: queries_to_add_) {
-            if (std::holds_alternative<BusQuery>(query)) {
-              BusQuery bus_query = std::get<BusQuery>(query);
-              auto *const bus = tc_.FindCreateBus(bus_query.name);
-              bus->route.is_roundtrip = bus_query.is_roundtrip;
-              for (const auto &stop: bus_query.route) {
-                const auto *const found_stop = tc_.FindStop(stop);
-                bus->route.stops.push_back(found_stop);
+            case RequestType::Stop: {
+              const auto &stop_name = request.name;
+              const auto buses_info = tc_.ComputeBusInfo(stop_name);
+              if (buses_info.not_found) {
+                writer.Key("error_message"sv).Value("not found"sv);
+              } else {
+                writer.Key("buses"sv).StartArray();
+                for (const auto &bus: buses_info.buses) {
+                  writer.Value(bus);
+                }
+                writer.EndArray();
               }
-              tc_.AddPassingBus(bus);
+              write_request_id();
+              break;
             }
-          }
-          queries_to_add_.clear();
-        }
-
-        json::Document QueryManager::GetJSONAnswers() {
-          using namespace std::literals;
-          auto jBuilder = json::Builder{};
-          jBuilder.StartArray();
-          for (const auto &request: requests_) {
-            jBuilder.StartDict();
-            jBuilder.Key("request_id"s).Value(static_cast<int>(request.id));
-            switch (request.type) {
-              case RequestType::Bus: {
-                const auto &bus_name = request.name;
-                const auto route_info = tc_.ComputeRouteInfo(bus_name);
-                if (route_info.not_found) {
-                  jBuilder.Key("error_message"s).Value("not found"s);
-                } else {
-                  jBuilder.Key("curvature"s).Value(route_info.curvature);
-                  jBuilder.Key("route_length"s).Value(route_info.route_length);
-                  jBuilder.Key("unique_stop_count"s).Value(static_cast<int>(route_info.unique_stops));
-                  jBuilder.Key("stop_count"s).Value(static_cast<int>(route_info.stops_on_route));
-                }
-                break;
+            case RequestType::Map: {
+              EnsureLoaded(LazyPart::Map);
+              if (request.buses) {
+                std::string map;
+                GetMapRenderer().DrawBuses(*request.buses, map);
+                writer.Key("map"sv).Value(std::string_view(map));
+              } else if (request.bounds) {
+                std::string map;
+                GetMapRenderer().DrawViewport(*request.bounds, map);
+                writer.Key("map"sv).Value(std::string_view(map));
+              } else if (!rendered_map_json_.empty()) {
+                // Карта из базы копируется в ответ целиком
+                writer.Key("map"sv).RawValue(rendered_map_json_);
+              } else {
+                // База старого формата без отрисованной карты
+                writer.Key("map"sv).Value(std::string_view(RenderMap()));
               }
-              case RequestType::Stop: {
-                const auto &stop_name = request.name;
-                const auto buses_info = tc_.ComputeBusInfo(stop_name);
-                if (buses_info.not_found) {
-                  jBuilder.Key("error_message"s).Value("not found"s);
-                } else {
-                  if (buses_info.buses.empty()) {
-                    jBuilder.Key("buses"s).StartArray().EndArray();
+              write_request_id();
+              break;
+            }
+            case RequestType::Route: {
+              EnsureLoaded(LazyPart::Router);
+              tr_->EnsureInitialized(routing_settings_);
+              const auto route_info = tr_->BuildRoute(request.from, request.to);
+              if (route_info.not_found) {
+                writer.Key("error_message"sv).Value("not found"sv);
+                write_request_id();
+              } else {
+                writer.Key("items"sv).StartArray();
+                for (const auto &item: route_info.items) {
+                  writer.StartDict();
+                  if (item.item_type == transcat::ItemType::WAIT) {
+                    writer.Key("stop_name"sv).Value(item.name);
+                    writer.Key("time"sv).Value(static_cast<double>(item.point_time));
+                    writer.Key("type"sv).Value("Wait"sv);
                   } else {
-                    jBuilder.Key("buses"s).StartArray();
-                    for (const auto &bus: buses_info.buses) {
-                      jBuilder.Value(std::string(bus));
-                    }
-                    jBuilder.EndArray();
+                    writer.Key("bus"sv).Value(item.name);
+                    writer.Key("span_count"sv).Value(static_cast<int>(item.span_count));
+                    writer.Key("time"sv).Value(static_cast<double>(item.point_time));
+                    writer.Key("type"sv).Value("Bus"sv);
                   }
+                  writer.EndDict();
                 }
-                break;
-              }
-              case RequestType::Map: {
-                transcat::MapRenderer map_renderer
-                    (GetAllOrderedRoutes(tc_), GetAllOrderedStops(tc_), GetAllPassingBuses(tc_), render_settings_);
-                const auto svg_doc = map_renderer.DrawRoutes();
-                std::stringstream stringstream;
-                svg_doc.Render(stringstream);
-                jBuilder.Key("map"s).Value(stringstream.str());
-                break;
+                writer.EndArray();
+                write_request_id();
+                writer.Key("total_time"sv).Value(route_info.total_time);
               }
-              case RequestType::Route: {
-              if (!tr_->IsInitialized()) {
-                  tr_->Initialize(routing_settings_);
-                }
-                const auto route_info = tr_->BuildRoute(request.from, request.to);
-                if (route_info.not_found) {
-                  jBuilder.Key("error_message"s).Value("not found"s);
-                } else {
-                  jBuilder.Key("total_time"s).Value(route_info.total_time);
-                  jBuilder.Key("items"s).StartArray();
-                  for (const auto &item: route_info.items) {
-                    jBuilder.StartDict();
-                    jBuilder.Key("time"s).Value(static_cast<double>(item.point_time));
-                    if (item.item_type == transcat::ItemType::WAIT) {
-                      jBuilder.Key("type"s).Value("Wait"s);
-                      jBuilder.Key("stop_name"s).Value(std::string(item.name));
-                    } else {
-                      jBuilder.Key("type"s).Value("Bus"s);
-                      jBuilder.Key("bus"s).Value(std::string(item.name));
-                      jBuilder.Key("span_count"s).Value(static_cast<int>(item.span_count));
-                    }
-                    jBuilder.EndDict();
+              break;
+            }
+            case RequestType::Autocomplete: {
+              EnsureLoaded(LazyPart::NameIndex);
+              writer.Key("items"sv).StartArray();
+              // Название остановки и маршрута одновременно даёт два элемента, limit ограничивает их число
+              size_t items_count = 0;
+              for (const auto &match: name_index_.Complete(request.prefix, request.limit, request.max_edits)) {
+                for (const auto kind: {STOP_NAME, BUS_NAME}) {
+                  if ((match.kinds & kind) == 0 || items_count == request.limit) {
+                    continue;
                   }
-                  jBuilder.EndArray();
+                  ++items_count;
+                  writer.StartDict();
+                  writer.Key("distance"sv).Value(static_cast<int>(match.distance));
+                  writer.Key("name"sv).Value(match.name);
+                  writer.Key("type"sv).Value(kind == STOP_NAME ? "Stop"sv : "Bus"sv);
+                  writer.EndDict();
                 }
-                break;
               }
+              writer.EndArray();
+              write_request_id();
+              break;
             }
-            jBuilder.EndDict();
+            case RequestType::DirectBuses: {
+              const auto buses_info = tc_.ComputeDirectBuses(request.from, request.to);
+              if (buses_info.not_found) {
+                writer.Key("error_message"sv).Value("not found"sv);
+              } else {
+                writer.Key("buses"sv).StartArray();
+                for (const auto &bus: buses_info.buses) {
+                  writer.Value(bus);
+                }
+                writer.EndArray();
+              }
+              write_request_id();
+              break;
+            }
+          }
+          writer.EndDict();
+        }
+
+        void QueryManager::WriteJSONAnswers(std::ostream &output) {
+          json::Writer writer(output, output_format_);
+          WriteAnswers(writer);
+        }
+
+        std::shared_ptr<const CachedAnswer> QueryManager::RenderAnswer(const Request &request,
+                                                                       const json::Writer &writer) const {
+          auto answer = std::make_shared<CachedAnswer>();
+          auto fragment = writer.Fragment();
+          WriteAnswer(request, fragment, &answer->id_offset);
+          answer->text = fragment.TakeFragment();
+          return answer;
+        }
 
+        void QueryManager::WriteAnswers(json::Writer &writer) {
+          writer.StartArray();
+          // Одинаковые по содержанию запросы вычисляются один раз, при первом вхождении.
+          // Готовый ответ хранится до последнего вхождения и выводится с номером каждого запроса
+          const size_t count = requests_.size();
+          std::vector<std::string> keys(count);
+          std::vector<size_t> first_use(count);
+          std::vector<size_t> last_use(count);
+          {
+            std::unordered_map<std::string_view, size_t> first_by_key;
+            first_by_key.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+              // Отступы в тексте ответа зависят от формата вывода
+              keys[i] = MakeRequestKey(requests_[i]);
+              keys[i].push_back(static_cast<char>(output_format_));
+              const auto[it, inserted] = first_by_key.emplace(keys[i], i);
+              first_use[i] = it->second;
+              last_use[it->second] = i;
+            }
           }
-          jBuilder.EndArray();
+          std::vector<std::shared_ptr<const CachedAnswer>> answers(count);
+
+          struct Slot {
+            size_t index;
+            std::shared_ptr<const CachedAnswer> answer;
+            bool computed = false;
+          };
+
+          // Ответы вычисляются параллельно и выводятся в порядке запросов.
+          // Число ответов в работе ограничено, поэтому долгий запрос Map не задерживает
+          // вычисление следующих за ним запросов и не требует держать в памяти все ответы
+          const auto max_tokens = static_cast<size_t>(4 * tbb::this_task_arena::max_concurrency());
+          size_t next_request = 0;
+          tbb::parallel_pipeline(
+              max_tokens,
+              tbb::make_filter<void, Slot>(
+                  tbb::filter_mode::serial_in_order,
+                  [this, &next_request, &keys, &first_use, count](tbb::flow_control &control) {
+                    Slot slot{next_request++, nullptr};
+                    if (slot.index >= count) {
+                      control.stop();
+                    } else if (answer_cache_ && first_use[slot.index] == slot.index) {
+                      slot.answer = answer_cache_->Find(keys[slot.index]);
+                    }
+                    return slot;
+                  })
+              & tbb::make_filter<Slot, Slot>(
+                  tbb::filter_mode::parallel,
+                  [this, &writer, &first_use](Slot slot) {
+                    if (first_use[slot.index] == slot.index && !slot.answer) {
+                      slot.answer = RenderAnswer(requests_[slot.index], writer);
+                      slot.computed = true;
+                    }
+                    return slot;
+                  })
+              & tbb::make_filter<Slot, void>(
+                  tbb::filter_mode::serial_in_order,
+                  [this, &writer, &keys, &first_use, &last_use, &answers](const Slot &slot) {
+                    const size_t first = first_use[slot.index];
+                    if (first == slot.index) {
+                      answers[first] = slot.answer;
+                      if (answer_cache_ && slot.computed) {
+                        answer_cache_->Insert(keys[first], slot.answer);
+                      }
+                    }
+                    char id[number_format::kMaxChars];
+                    const std::string_view id_text(id, number_format::ToChars(id, requests_[slot.index].id) - id);
+                    writer.RawValue({answers[first]->Prefix(), id_text, answers[first]->Suffix()});
+                    if (last_use[first] == slot.index) {
+                      answers[first].reset();
+                    }
+                  }));
+          writer.EndArray();
           requests_.clear();
-          json::Document doc{jBuilder.Build()};
-          return doc;
+        }
+
+        void QueryManager::EnableAnswerCache(size_t capacity_bytes) {
+          answer_cache_ = std::make_unique<AnswerCache>(capacity_bytes);
+        }
+
+        const AnswerCache *QueryManager::GetAnswerCache() const {
+          return answer_cache_.get();
         }
 
         void QueryManager::SetTransportRouter(std::shared_ptr<transcat::TransportRouter> transport_router) {
@@ -357,15 +732,95 @@ namespace transcat
           return tr_;
         }
 
+        void QueryManager::SetNameIndex(transcat::NameIndex name_index) {
+          name_index_ = std::move(name_index);
+        }
+
+        void QueryManager::SetRenderedMap(std::string_view rendered_map) {
+          // Экранирование от формата вывода не зависит, поэтому выполняется один раз при загрузке
+          json::Writer fragment(json::PrintFormat::Compact, 0);
+          fragment.Value(rendered_map);
+          rendered_map_json_ = fragment.TakeFragment();
+        }
+
+        void QueryManager::SetLazyLoader(LazyPart part, std::function<void()> loader) {
+          lazy_loaders_[static_cast<size_t>(part)] = std::move(loader);
+        }
+
+        void QueryManager::EnsureLoaded(LazyPart part) const {
+          const auto index = static_cast<size_t>(part);
+          std::call_once(lazy_flags_[index], [this, index] {
+            if (lazy_loaders_[index]) {
+              lazy_loaders_[index]();
+            }
+          });
+        }
+
+        std::string QueryManager::RenderMap() const {
+          std::string map;
+          GetMapRenderer().DrawRoutes(map);
+          return map;
+        }
+
+        const MapRenderer &QueryManager::GetMapRenderer() const {
+          // Справочник к первому запросу Map уже заполнен и больше не меняется
+          std::call_once(map_renderer_flag_, [this] {
+            EnsureLoaded(LazyPart::Map);
+            map_renderer_ = std::make_unique<MapRenderer>
+                (GetAllOrderedRoutes(tc_), GetAllOrderedStops(tc_), GetAllPassingBuses(tc_),
+                 tc_.GetRoutedStopsBounds(), render_settings_);
+          });
+          return *map_renderer_;
+        }
+
+        void QueryManager::AnswerLine(std::string_view line, std::ostream &output) {
+          const auto document = json::Load(std::string(line));
+          const auto &root = document.GetRoot();
+          // Ответ копится в памяти и выводится только целиком: при ошибке в середине пакета
+          // в поток не попадает обрывок строки, и вызывающий выводит вместо него сообщение об ошибке
+          json::Writer writer(json::PrintFormat::Compact, 0);
+          if (const auto it = root.AsDict().find("command"sv); it != root.AsDict().end()) {
+            if (it->second.AsString() != "stats"sv) {
+              throw std::invalid_argument("Unknown command: "s + std::string(it->second.AsString()));
+            }
+            const size_t hits = answer_cache_ ? answer_cache_->GetHits() : 0;
+            const size_t misses = answer_cache_ ? answer_cache_->GetMisses() : 0;
+            writer.StartDict()
+                .Key("cache_hits"sv).Value(static_cast<int>(hits))
+                .Key("cache_misses"sv).Value(static_cast<int>(misses))
+                .EndDict();
+          } else if (const auto it = root.AsDict().find("stat_requests"sv); it != root.AsDict().end()) {
+            requests_.clear();
+            ReadStatRequests(it->second, requests_);
+            WriteAnswers(writer);
+          } else {
+            WriteAnswer(ReadStatRequest(root), writer);
+          }
+          const auto answer = writer.TakeFragment();
+          output.write(answer.data(), static_cast<std::streamsize>(answer.size()));
+          output << '\n' << std::flush;
+        }
+
+        void QueryManager::LoadBase(std::string file) {
+          serialization_settings_.file = std::move(file);
+          Deserialize();
+        }
+
         void QueryManager::Serialize() {
-          transcat::TransportRouter transport_router(tc_);
-          tr_ = std::make_shared<transcat::TransportRouter>(transport_router);
-          SerializeTransportCatalogue(serialization_settings_.file, tc_, render_settings_, routing_settings_, tr_);
+          tr_ = std::make_shared<transcat::TransportRouter>(tc_);
+          name_index_ = transcat::NameIndex(tc_);
+          SerializeTransportCatalogue(serialization_settings_.file,
+                                      serialization_settings_.format,
+                                      tc_,
+                                      render_settings_,
+                                      routing_settings_,
+                                      tr_,
+                                      name_index_,
+                                      serialization_settings_.prerender_map ? RenderMap() : std::string{});
         }
 
         void QueryManager::Deserialize() {
           DeserializeTransportCatalogue(serialization_settings_.file,
-                                        queries_to_add_,
                                         render_settings_,
                                         routing_settings_,
                                         this,
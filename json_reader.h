@@ -1,13 +1,21 @@
 #pragma once
 
+#include<array>
+#include<functional>
 #include<iostream>
 #include<memory>
+#include<mutex>
+#include<string>
+#include<string_view>
 #include<vector>
 
+#include "answer_cache.h"
 #include "domain.h"
 #include "geo.h"
 #include "json.h"
+#include "json_writer.h"
 #include "map_renderer.h"
+#include "name_index.h"
 #include "svg.h"
 #include "transport_router.h"
 
@@ -22,22 +30,64 @@ namespace transcat
               {
           }
           void ReadJsonRequests(std::istream &input);
-          json::Document GetJSONAnswers();
+          // Выводит ответы в поток по мере вычисления, не строя json::Document
+          void WriteJSONAnswers(std::ostream &output);
+
+          // Режим serve: строка содержит пакет {"stat_requests": [...]}, одиночный запрос
+          // либо {"command": "stats"} со счётчиками кеша ответов, ответ выводится в одну строку
+          void AnswerLine(std::string_view line, std::ostream &output);
+          // Задаёт формат вывода, который output_settings из запросов уже не меняют
+          void ForceOutputFormat(json::PrintFormat output_format) {
+            output_format_ = output_format;
+            output_format_forced_ = true;
+          }
+
+          // Включает кеш ответов между пакетами, ограниченный суммарным размером ответов
+          void EnableAnswerCache(size_t capacity_bytes);
+          const AnswerCache *GetAnswerCache() const;
 
           void Serialize();
           void Deserialize();
+          void LoadBase(std::string file);
           void SetTransportRouter(std::shared_ptr<transcat::TransportRouter> transport_router);
           const std::shared_ptr<transcat::TransportRouter>& GetTranstoptRouter() const;
-          void AddQueriesToTC();
+          void SetNameIndex(transcat::NameIndex name_index);
+          // Карта, отрисованная при make_base: запросы Map отвечают ею без повторной отрисовки
+          void SetRenderedMap(std::string_view rendered_map);
+
+          // Части базы, которые загружаются при первом запросе, которому они нужны
+          enum class LazyPart {
+            Router,
+            NameIndex,
+            Map
+          };
+          void SetLazyLoader(LazyPart part, std::function<void()> loader);
          private:
+          void WriteAnswer(const Request &request, json::Writer &writer, size_t *request_id_offset = nullptr) const;
+          std::shared_ptr<const CachedAnswer> RenderAnswer(const Request &request, const json::Writer &writer) const;
+          void WriteAnswers(json::Writer &writer);
+          std::string RenderMap() const;
+          const MapRenderer &GetMapRenderer() const;
+          // Потокобезопасно вызывает загрузчик части базы, если он задан, не более одного раза
+          void EnsureLoaded(LazyPart part) const;
 
-          std::vector<InfoQuery> queries_to_add_;
           std::vector<Request> requests_;
           TransportCatalogue &tc_;
           std::shared_ptr<transcat::TransportRouter> tr_;
+          transcat::NameIndex name_index_;
           transcat::RenderSettings render_settings_;
           transcat::RoutingSettings routing_settings_;
           transcat::SerializationSettings serialization_settings_;
+          json::PrintFormat output_format_ = json::PrintFormat::Pretty;
+          bool output_format_forced_ = false;
+          std::unique_ptr<AnswerCache> answer_cache_;
+          // Карта из базы в виде готового значения JSON: в кавычках и с экранированием
+          std::string rendered_map_json_;
+          mutable std::once_flag map_renderer_flag_;
+          mutable std::unique_ptr<MapRenderer> map_renderer_;
+          static constexpr size_t kLazyPartCount = 3;
+          std::array<std::function<void()>, kLazyPartCount> lazy_loaders_;
+          mutable std::array<std::once_flag, kLazyPartCount> lazy_flags_;
 
         };
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace json
+  {
+    namespace detail
+      {
+        inline bool IsSpecialChar(char c) {
+          return c == '"' || c == '\\' || c == '\n' || c == '\r';
+        }
+
+        /*
+         * Возвращает указатель на первый символ из ", \, \n, \r в [first, last) либо last.
+         * Это символы, на которых разбор строки останавливается, а при выводе экранируются,
+         * поэтому участки между ними копируются целиком. Поиск идёт блоками по 32 (AVX2)
+         * или 16 (SSE2) байт, остаток и платформы без SIMD обрабатываются посимвольно
+         */
+        inline const char *FindSpecialChar(const char *first, const char *last) {
+#if defined(__AVX2__)
+          const __m256i quote = _mm256_set1_epi8('"');
+          const __m256i backslash = _mm256_set1_epi8('\\');
+          const __m256i line_feed = _mm256_set1_epi8('\n');
+          const __m256i carriage_return = _mm256_set1_epi8('\r');
+          while (last - first >= 32) {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+            const __m256i found = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, line_feed), _mm256_cmpeq_epi8(chunk, carriage_return)));
+            const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(found));
+            if (mask != 0) {
+              return first + __builtin_ctz(mask);
+            }
+            first += 32;
+          }
+#endif
+#if defined(__SSE2__)
+          const __m128i quote16 = _mm_set1_epi8('"');
+          const __m128i backslash16 = _mm_set1_epi8('\\');
+          const __m128i line_feed16 = _mm_set1_epi8('\n');
+          const __m128i carriage_return16 = _mm_set1_epi8('\r');
+          while (last - first >= 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+            const __m128i found = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote16), _mm_cmpeq_epi8(chunk, backslash16)),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed16), _mm_cmpeq_epi8(chunk, carriage_return16)));
+            const auto mask = static_cast<unsigned>(_mm_movemask_epi8(found));
+            if (mask != 0) {
+              return first + __builtin_ctz(mask);
+            }
+            first += 16;
+          }
+#endif
+          while (first != last && !IsSpecialChar(*first)) {
+            ++first;
+          }
+          return first;
+        }
+      }
+  }
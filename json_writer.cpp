@@ -0,0 +1,239 @@
+#include "json_writer.h"
+#include "json_scan.h"
+#include "number_format.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace json
+  {
+    using namespace std::literals;
+
+    Writer::Writer(std::ostream &out, PrintFormat format, size_t flush_threshold)
+        : out_(&out)
+        , format_(format)
+        , pretty_(format == PrintFormat::Pretty)
+        , lines_(format == PrintFormat::Lines)
+        , flush_threshold_(flush_threshold) {
+      buffer_.reserve(flush_threshold_ + flush_threshold_ / 4);
+    }
+
+    Writer::Writer(PrintFormat format, size_t depth)
+        : out_(nullptr)
+        , format_(format)
+        , base_depth_(depth)
+        , pretty_(format == PrintFormat::Pretty)
+        , lines_(format == PrintFormat::Lines && depth == 0)
+        , flush_threshold_(std::numeric_limits<size_t>::max()) {
+    }
+
+    Writer::~Writer() {
+      Flush();
+    }
+
+    Writer &Writer::Key(std::string_view key) {
+      if (frames_.empty() || !frames_.back().is_dict || after_key_) {
+        throw std::logic_error("Key error"s);
+      }
+      auto &frame = frames_.back();
+      if (!frame.first) {
+        WriteSeparator();
+      }
+      frame.first = false;
+      WriteIndent();
+      WriteEscaped(key);
+      buffer_ += pretty_ ? ": "sv : ":"sv;
+      after_key_ = true;
+      return *this;
+    }
+
+    Writer &Writer::Value(std::string_view value) {
+      BeginValue();
+      WriteEscaped(value);
+      EndValue();
+      return *this;
+    }
+
+    Writer &Writer::Value(int value) {
+      BeginValue();
+      number_format::Append(buffer_, value);
+      EndValue();
+      return *this;
+    }
+
+    Writer &Writer::Value(double value) {
+      BeginValue();
+      number_format::Append(buffer_, value);
+      EndValue();
+      return *this;
+    }
+
+    Writer &Writer::Value(bool value) {
+      BeginValue();
+      buffer_ += value ? "true"sv : "false"sv;
+      EndValue();
+      return *this;
+    }
+
+    Writer &Writer::Value(std::nullptr_t) {
+      BeginValue();
+      buffer_ += "null"sv;
+      EndValue();
+      return *this;
+    }
+
+    Writer &Writer::RawValue(std::string_view json) {
+      BeginValue();
+      buffer_ += json;
+      EndValue();
+      return *this;
+    }
+
+    Writer &Writer::RawValue(std::initializer_list<std::string_view> parts) {
+      BeginValue();
+      for (const auto part: parts) {
+        buffer_ += part;
+      }
+      EndValue();
+      return *this;
+    }
+
+    Writer &Writer::StartDict() {
+      BeginValue();
+      buffer_.push_back('{');
+      if (pretty_) {
+        buffer_.push_back('\n');
+      }
+      frames_.push_back({true});
+      return *this;
+    }
+
+    Writer &Writer::EndDict() {
+      if (frames_.empty() || !frames_.back().is_dict || after_key_) {
+        throw std::logic_error("Ending dict error"s);
+      }
+      frames_.pop_back();
+      if (pretty_) {
+        buffer_.push_back('\n');
+        WriteIndent();
+      }
+      buffer_.push_back('}');
+      EndValue();
+      return *this;
+    }
+
+    Writer &Writer::StartArray() {
+      BeginValue();
+      // В формате Lines корневой массив выводится без скобок, по элементу на строку
+      if (!lines_ || !frames_.empty()) {
+        buffer_.push_back('[');
+      }
+      if (pretty_) {
+        buffer_.push_back('\n');
+      }
+      frames_.push_back({false});
+      return *this;
+    }
+
+    Writer &Writer::EndArray() {
+      if (frames_.empty() || frames_.back().is_dict) {
+        throw std::logic_error("Ending array error"s);
+      }
+      const bool root_lines = IsRootLinesArray();
+      frames_.pop_back();
+      if (pretty_) {
+        buffer_.push_back('\n');
+        WriteIndent();
+      }
+      if (!root_lines) {
+        buffer_.push_back(']');
+      }
+      EndValue();
+      return *this;
+    }
+
+    void Writer::Flush() {
+      if (out_ == nullptr) {
+        return;
+      }
+      if (!buffer_.empty()) {
+        out_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+      }
+      out_->flush();
+    }
+
+    void Writer::BeginValue() {
+      if (after_key_) {
+        after_key_ = false;
+        return;
+      }
+      if (frames_.empty()) {
+        return;
+      }
+      auto &frame = frames_.back();
+      if (frame.is_dict) {
+        throw std::logic_error("Value error"s);
+      }
+      if (!frame.first && !IsRootLinesArray()) {
+        WriteSeparator();
+      }
+      frame.first = false;
+      WriteIndent();
+    }
+
+    void Writer::EndValue() {
+      if (IsRootLinesArray()) {
+        buffer_.push_back('\n');
+      }
+      if (buffer_.size() >= flush_threshold_) {
+        Flush();
+      }
+    }
+
+    void Writer::WriteIndent() {
+      if (pretty_) {
+        buffer_.append((base_depth_ + frames_.size()) * 4, ' ');
+      }
+    }
+
+    void Writer::WriteSeparator() {
+      buffer_ += pretty_ ? ",\n"sv : ","sv;
+    }
+
+    bool Writer::IsRootLinesArray() const {
+      return lines_ && frames_.size() == 1 && !frames_.front().is_dict;
+    }
+
+    void Writer::WriteEscaped(std::string_view value) {
+      buffer_.push_back('"');
+      AppendEscaped(value);
+      buffer_.push_back('"');
+    }
+
+    void Writer::AppendEscaped(std::string_view value) {
+      const char *run = value.data();
+      const char *const end = run + value.size();
+      while (true) {
+        const char *special = detail::FindSpecialChar(run, end);
+        buffer_.append(run, special);
+        if (special == end) {
+          break;
+        }
+        switch (*special) {
+          case '\r':
+            buffer_ += "\\r"sv;
+            break;
+          case '\n':
+            buffer_ += "\\n"sv;
+            break;
+          default:
+            // Символы " и \ выводятся как \" или \\, соответственно
+            buffer_.push_back('\\');
+            buffer_.push_back(*special);
+            break;
+        }
+        run = special + 1;
+      }
+    }
+  }
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+namespace json
+  {
+    /*
+     * Потоковая запись JSON без построения дерева json::Node.
+     * Вывод совпадает с json::Print в том же формате: ключи выводятся в порядке вызовов Key,
+     * поэтому для совпадения с Print их нужно передавать отсортированными.
+     * Текст копится в буфере и сбрасывается в поток крупными блоками
+     */
+    class Writer {
+     public:
+      static constexpr size_t kDefaultFlushThreshold = 1 << 20;
+
+      explicit Writer(std::ostream &out, PrintFormat format = PrintFormat::Pretty,
+                      size_t flush_threshold = kDefaultFlushThreshold);
+      // Пишет в память фрагмент, который будет вставлен на глубине depth
+      Writer(PrintFormat format, size_t depth);
+      Writer(const Writer &) = delete;
+      Writer &operator=(const Writer &) = delete;
+      ~Writer();
+
+      Writer &Key(std::string_view key);
+      Writer &Value(std::string_view value);
+      Writer &Value(const char *value) {
+        return Value(std::string_view(value));
+      }
+      Writer &Value(int value);
+      Writer &Value(double value);
+      Writer &Value(bool value);
+      Writer &Value(std::nullptr_t);
+      // Вставляет готовый текст значения, например построенный writer из Fragment()
+      Writer &RawValue(std::string_view json);
+      // То же для текста, составленного из нескольких частей
+      Writer &RawValue(std::initializer_list<std::string_view> parts);
+      Writer &StartDict();
+      Writer &EndDict();
+      Writer &StartArray();
+      Writer &EndArray();
+
+      void Flush();
+
+      // Writer для фрагмента, который затем передаётся в RawValue этого writer
+      Writer Fragment() const {
+        return Writer(format_, base_depth_ + frames_.size());
+      }
+      std::string TakeFragment() {
+        return std::move(buffer_);
+      }
+      // Текущая длина фрагмента, позволяет запомнить место значения внутри него
+      size_t GetFragmentSize() const {
+        return buffer_.size();
+      }
+
+     private:
+      struct Frame {
+        bool is_dict;
+        bool first = true;
+      };
+
+      void BeginValue();
+      void EndValue();
+      void WriteIndent();
+      void WriteSeparator();
+      bool IsRootLinesArray() const;
+      void WriteEscaped(std::string_view value);
+      void AppendEscaped(std::string_view value);
+
+      std::ostream *out_;
+      PrintFormat format_;
+      size_t base_depth_ = 0;
+      bool pretty_;
+      bool lines_;
+      size_t flush_threshold_;
+      std::string buffer_;
+      std::vector<Frame> frames_;
+      bool after_key_ = false;
+    };
+  }
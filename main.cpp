@@ -1,26 +1,66 @@
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <string_view>
 
 #include "json_reader.h"
+#include "serve.h"
 #include "transport_catalogue.h"
 
 using namespace std::literals;
 using namespace transcat;
 
+// Ответы повторяющихся запросов в режиме serve хранятся между пакетами в пределах этого объёма
+constexpr size_t kServeAnswerCacheBytes = size_t{64} << 20;
+
 void PrintUsage(std::ostream& stream = std::cerr) {
   stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+  stream << "       transport_catalogue serve [base_file|-] [socket_path]\n"sv;
 }
 
 int main(int argc, char* argv[]) {
 
-  if (argc != 2) {
+  if (argc < 2) {
     PrintUsage();
     return 1;
   }
 
   const std::string_view mode(argv[1]);
 
+  if (mode == "serve"sv && argc <= 4) {
+
+    // База загружается один раз: из указанного файла либо по serialization_settings
+    // из первой строки входа, которая в остальном обрабатывается как process_requests
+    TransportCatalogue tc;
+    queries::QueryManager qm(tc);
+    // Каждый ответ — одна строка JSON Lines, поэтому output_settings из запросов не действуют
+    qm.ForceOutputFormat(json::PrintFormat::Compact);
+    qm.EnableAnswerCache(kServeAnswerCacheBytes);
+    if (argc >= 3 && argv[2] != "-"sv) {
+      qm.LoadBase(argv[2]);
+    } else {
+      std::string first_line;
+      std::getline(std::cin, first_line);
+      std::istringstream first_batch(first_line);
+      qm.ReadJsonRequests(first_batch);
+      qm.Deserialize();
+      qm.WriteJSONAnswers(std::cout);
+      std::cout << '\n' << std::flush;
+    }
+    if (argc == 4) {
+      serve::ServeUnixSocket(qm, argv[3]);
+    } else {
+      serve::ServeStream(qm, std::cin, std::cout);
+    }
+    return 0;
+  }
+
+  if (argc != 2) {
+    PrintUsage();
+    return 1;
+  }
+
   if (mode == "make_base"sv) {
 
     TransportCatalogue tc;
@@ -34,7 +74,7 @@ int main(int argc, char* argv[]) {
     queries::QueryManager qm(tc);
     qm.ReadJsonRequests(std::cin);
     qm.Deserialize();
-    json::Print(qm.GetJSONAnswers(), std::cout);
+    qm.WriteJSONAnswers(std::cout);
 
   } else {
     PrintUsage();
@@ -0,0 +1,168 @@
+#include "map_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <tuple>
+
+namespace transcat
+  {
+    namespace
+      {
+        // Примерное число остановок в ячейке сетки
+        constexpr size_t kStopsPerCell = 4;
+        constexpr size_t kMaxCellsPerSide = 1024;
+
+        /*
+         * Раскладывает элементы по ячейкам за два прохода: подсчёт размеров ячеек и заполнение.
+         * for_each(emit) вызывает emit(cell, item) для каждой пары ячейка-элемент в одном и том же порядке
+         */
+        template<typename Item, typename ForEach>
+        void FillCells(size_t cell_count, ForEach for_each,
+                       std::vector<uint32_t> &offsets, std::vector<Item> &items) {
+          offsets.assign(cell_count + 1, 0);
+          for_each([&offsets](size_t cell, const Item &) {
+            ++offsets[cell + 1];
+          });
+          std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+          items.resize(offsets.back());
+          std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+          for_each([&next, &items](size_t cell, const Item &item) {
+            items[next[cell]++] = item;
+          });
+        }
+
+        size_t CellOf(double value, double min, double cell_size, size_t count) {
+          if (cell_size <= 0) {
+            return 0;
+          }
+          const double cell = std::floor((value - min) / cell_size);
+          return static_cast<size_t>(std::clamp(cell, 0.0, static_cast<double>(count - 1)));
+        }
+      }
+
+    MapIndex::MapIndex(const std::vector<MapRoute> &routes, const std::vector<MapStop> &stops)
+        : routes_(routes)
+        , stops_(stops) {
+      bool empty = true;
+      const auto extend = [this, &empty](geo::Coordinates point) {
+        if (empty) {
+          extent_ = {point, point};
+          empty = false;
+          return;
+        }
+        extent_.min.lat = std::min(extent_.min.lat, point.lat);
+        extent_.min.lng = std::min(extent_.min.lng, point.lng);
+        extent_.max.lat = std::max(extent_.max.lat, point.lat);
+        extent_.max.lng = std::max(extent_.max.lng, point.lng);
+      };
+      for (const auto &stop: stops_) {
+        extend(stop.stop->coords);
+      }
+      for (const auto &route: routes_) {
+        for (const auto *stop: route.bus->route.stops) {
+          extend(stop->coords);
+        }
+      }
+
+      const auto side = std::clamp<size_t>(
+          static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(stops_.size()) / kStopsPerCell))),
+          1, kMaxCellsPerSide);
+      rows_ = side;
+      columns_ = side;
+      cell_height_ = (extent_.max.lat - extent_.min.lat) / static_cast<double>(rows_);
+      cell_width_ = (extent_.max.lng - extent_.min.lng) / static_cast<double>(columns_);
+
+      FillCells<uint32_t>(rows_ * columns_, [this](auto emit) {
+        for (uint32_t i = 0; i < stops_.size(); ++i) {
+          const auto point = stops_[i].stop->coords;
+          emit(Row(point.lat) * columns_ + Column(point.lng), i);
+        }
+      }, stop_offsets_, stop_items_);
+
+      FillCells<SegmentRef>(rows_ * columns_, [this](auto emit) {
+        for (uint32_t route = 0; route < routes_.size(); ++route) {
+          const auto stop_count = routes_[route].bus->route.stops.size();
+          const auto segment_count = stop_count > 1 ? stop_count - 1 : stop_count;
+          for (uint32_t segment = 0; segment < segment_count; ++segment) {
+            const SegmentRef ref{route, segment};
+            const auto cells = CellsOf(SegmentBounds(ref));
+            for (size_t row = cells.first_row; row <= cells.last_row; ++row) {
+              for (size_t column = cells.first_column; column <= cells.last_column; ++column) {
+                emit(row * columns_ + column, ref);
+              }
+            }
+          }
+        }
+      }, segment_offsets_, segment_items_);
+    }
+
+    std::vector<uint32_t> MapIndex::FindStops(const geo::Bounds &bounds) const {
+      std::vector<uint32_t> result;
+      if (stop_items_.empty() || !extent_.Intersects(bounds)) {
+        return result;
+      }
+      const auto cells = CellsOf(bounds);
+      for (size_t row = cells.first_row; row <= cells.last_row; ++row) {
+        for (size_t column = cells.first_column; column <= cells.last_column; ++column) {
+          const size_t cell = row * columns_ + column;
+          for (uint32_t i = stop_offsets_[cell]; i < stop_offsets_[cell + 1]; ++i) {
+            if (bounds.Contains(stops_[stop_items_[i]].stop->coords)) {
+              result.push_back(stop_items_[i]);
+            }
+          }
+        }
+      }
+      // Каждая остановка лежит ровно в одной ячейке, повторов нет
+      std::sort(result.begin(), result.end());
+      return result;
+    }
+
+    std::vector<SegmentRef> MapIndex::FindSegments(const geo::Bounds &bounds) const {
+      std::vector<SegmentRef> result;
+      if (segment_items_.empty() || !extent_.Intersects(bounds)) {
+        return result;
+      }
+      const auto cells = CellsOf(bounds);
+      for (size_t row = cells.first_row; row <= cells.last_row; ++row) {
+        for (size_t column = cells.first_column; column <= cells.last_column; ++column) {
+          const size_t cell = row * columns_ + column;
+          for (uint32_t i = segment_offsets_[cell]; i < segment_offsets_[cell + 1]; ++i) {
+            if (bounds.Intersects(SegmentBounds(segment_items_[i]))) {
+              result.push_back(segment_items_[i]);
+            }
+          }
+        }
+      }
+      // Длинный отрезок встречается в нескольких ячейках
+      const auto less = [](SegmentRef lhs, SegmentRef rhs) {
+        return std::tie(lhs.route, lhs.segment) < std::tie(rhs.route, rhs.segment);
+      };
+      const auto equal = [](SegmentRef lhs, SegmentRef rhs) {
+        return lhs.route == rhs.route && lhs.segment == rhs.segment;
+      };
+      std::sort(result.begin(), result.end(), less);
+      result.erase(std::unique(result.begin(), result.end(), equal), result.end());
+      return result;
+    }
+
+    geo::Bounds MapIndex::SegmentBounds(SegmentRef segment) const {
+      const auto &stops = routes_[segment.route].bus->route.stops;
+      const auto from = stops[segment.segment]->coords;
+      const auto to = stops[std::min<size_t>(segment.segment + 1, stops.size() - 1)]->coords;
+      return {{std::min(from.lat, to.lat), std::min(from.lng, to.lng)},
+              {std::max(from.lat, to.lat), std::max(from.lng, to.lng)}};
+    }
+
+    MapIndex::CellRange MapIndex::CellsOf(const geo::Bounds &bounds) const {
+      return {Row(bounds.min.lat), Row(bounds.max.lat), Column(bounds.min.lng), Column(bounds.max.lng)};
+    }
+
+    size_t MapIndex::Row(double lat) const {
+      return CellOf(lat, extent_.min.lat, cell_height_, rows_);
+    }
+
+    size_t MapIndex::Column(double lng) const {
+      return CellOf(lng, extent_.min.lng, cell_width_, columns_);
+    }
+  }
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "domain.h"
+#include "geo.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace transcat
+  {
+    /*
+     * Маршрут на карте вместе с индексами его цветов в палитре.
+     * Индексы вычисляются заранее, поэтому любой участок слоя отрисовывается независимо от предыдущих
+     */
+    struct MapRoute {
+      std::string_view name;
+      const Bus *bus = nullptr;
+      size_t line_color = 0;
+      size_t label_color = 0;
+    };
+
+    // Остановка, через которую проходит хотя бы один маршрут
+    struct MapStop {
+      std::string_view name;
+      const Stop *stop = nullptr;
+    };
+
+    // Отрезок маршрута route между остановками segment и segment + 1
+    struct SegmentRef {
+      uint32_t route;
+      uint32_t segment;
+    };
+
+    /*
+     * Равномерная сетка по широте и долготе над остановками и отрезками маршрутов карты.
+     * Ячейки хранятся подряд, как в CSR-матрице: элементы ячейки i лежат в [offsets[i], offsets[i + 1]).
+     * Отрезок попадает во все ячейки, которые пересекает его ограничивающий прямоугольник.
+     * Маршрут из одной остановки представлен вырожденным отрезком 0
+     */
+    class MapIndex {
+     public:
+      MapIndex(const std::vector<MapRoute> &routes, const std::vector<MapStop> &stops);
+
+      // Номера остановок внутри области, по возрастанию
+      std::vector<uint32_t> FindStops(const geo::Bounds &bounds) const;
+      // Отрезки, прямоугольник которых пересекает область, упорядоченные по маршруту и номеру отрезка
+      std::vector<SegmentRef> FindSegments(const geo::Bounds &bounds) const;
+
+     private:
+      struct CellRange {
+        size_t first_row;
+        size_t last_row;
+        size_t first_column;
+        size_t last_column;
+      };
+
+      geo::Bounds SegmentBounds(SegmentRef segment) const;
+      CellRange CellsOf(const geo::Bounds &bounds) const;
+      size_t Row(double lat) const;
+      size_t Column(double lng) const;
+
+      const std::vector<MapRoute> &routes_;
+      const std::vector<MapStop> &stops_;
+      geo::Bounds extent_;
+      size_t rows_ = 1;
+      size_t columns_ = 1;
+      double cell_height_ = 0;
+      double cell_width_ = 0;
+      std::vector<uint32_t> stop_offsets_;
+      std::vector<uint32_t> stop_items_;
+      std::vector<uint32_t> segment_offsets_;
+      std::vector<SegmentRef> segment_items_;
+    };
+  }
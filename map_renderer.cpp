@@ -1,7 +1,10 @@
 #include "map_renderer.h"
 #include "svg.h"
 
-#include <unordered_set>
+#include <algorithm>
+#include <cmath>
+
+#include <tbb/parallel_for.h>
 
 namespace detail
   {
@@ -11,209 +14,489 @@ namespace detail
     }
   }
 
-void SetTextSettings(svg::Text &text,
-                     const std::string_view data,
-                     const svg::Point &point,
-                     const transcat::RenderSettings &render_settings) {
-  using namespace std::literals;
-  text.SetPosition(point);
-  text.SetOffset({render_settings.bus_label_offset[0], render_settings.bus_label_offset[1]});
-  text.SetFontSize(render_settings.bus_label_font_size);
-  text.SetFontFamily("Verdana"s);
-  text.SetFontWeight("bold"s);
-  text.SetData(std::string(data));
-}
-
-void SetTextLayerSettings(svg::Text &text, const transcat::RenderSettings &render_settings) {
-  text.SetFillColor(render_settings.underlayer_color);
-  text.SetStrokeColor(render_settings.underlayer_color);
-  text.SetStrokeWidth(render_settings.underlayer_width);
-  text.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-  text.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-}
-
-void SetStopTextSettings(svg::Text &text,
-                         const std::string_view data,
-                         const svg::Point &point,
-                         const transcat::RenderSettings &render_settings) {
-  using namespace std::literals;
-  text.SetPosition(point);
-  text.SetOffset({render_settings.stop_label_offset[0], render_settings.stop_label_offset[1]});
-  text.SetFontSize(render_settings.stop_label_font_size);
-  text.SetFontFamily("Verdana"s);
-  text.SetData(std::string(data));
-}
-
-void SetStopTextLayerSettings(svg::Text &text, const transcat::RenderSettings &render_settings) {
-  text.SetFillColor(render_settings.underlayer_color);
-  text.SetStrokeColor(render_settings.underlayer_color);
-  text.SetStrokeWidth(render_settings.underlayer_width);
-  text.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-  text.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-}
-
-void SetPolylineSettings(svg::Polyline &polyline, const transcat::RenderSettings &render_settings) {
-  using namespace std::literals;
-  polyline.SetFillColor("none"s);
-  polyline.SetStrokeWidth(render_settings.line_width);
-  polyline.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-  polyline.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-}
-
-transcat::SphereProjector CreateSphereProjector(const std::map<const std::string_view
-                                                               , const transcat::Bus *
-                                                               , std::less<>> &all_routes,
-                                                const transcat::RenderSettings &render_settings) {
-  std::unordered_set<geo::Coordinates, geo::CoordinatesHash> coords;
-  for (const auto &[key, bus]: all_routes) {
-    for (const auto &stop: bus->route.stops) {
-      coords.insert(stop->coords);
+namespace
+  {
+    using namespace std::literals;
+
+    const svg::Color kStopColor{"white"s};
+    const svg::Color kStopTextColor{"black"s};
+
+    // Размеры участков слоя, которые отрисовываются отдельными задачами
+    constexpr size_t kRoutesPerChunk = 64;
+    constexpr size_t kStopsPerChunk = 256;
+    // Объём кеша фрагментов для карт отдельных маршрутов
+    constexpr size_t kFragmentCacheBytes = 32 << 20;
+    // Запас под заголовок и закрывающий тег документа
+    constexpr size_t kDocumentFrameSize = 128;
+
+    svg::TextStyle BusTextStyle(const transcat::RenderSettings &render_settings) {
+      svg::TextStyle style;
+      style.offset = {render_settings.bus_label_offset[0], render_settings.bus_label_offset[1]};
+      style.font_size = static_cast<uint32_t>(render_settings.bus_label_font_size);
+      style.font_family = "Verdana"sv;
+      style.font_weight = "bold"sv;
+      return style;
+    }
+
+    svg::TextStyle StopTextStyle(const transcat::RenderSettings &render_settings) {
+      svg::TextStyle style;
+      style.offset = {render_settings.stop_label_offset[0], render_settings.stop_label_offset[1]};
+      style.font_size = static_cast<uint32_t>(render_settings.stop_label_font_size);
+      style.font_family = "Verdana"sv;
+      return style;
+    }
+
+    // Подложка под названиями остановок и маршрутов
+    svg::PathStyle UnderlayerStyle(const transcat::RenderSettings &render_settings) {
+      svg::PathStyle style;
+      style.fill_color = &render_settings.underlayer_color;
+      style.stroke_color = &render_settings.underlayer_color;
+      style.stroke_width = render_settings.underlayer_width;
+      style.stroke_line_cap = svg::StrokeLineCap::ROUND;
+      style.stroke_line_join = svg::StrokeLineJoin::ROUND;
+      return style;
+    }
+
+    svg::PathStyle PolylineStyle(const transcat::RenderSettings &render_settings) {
+      svg::PathStyle style;
+      style.fill_color = &svg::NoneColor;
+      style.stroke_width = render_settings.line_width;
+      style.stroke_line_cap = svg::StrokeLineCap::ROUND;
+      style.stroke_line_join = svg::StrokeLineJoin::ROUND;
+      return style;
+    }
+
+    // Расстояние от точки до отрезка [a, b] в градусах, долгота и широта считаются декартовыми осями
+    double DistanceToSegment(geo::Coordinates point, geo::Coordinates a, geo::Coordinates b) {
+      const double dx = b.lng - a.lng;
+      const double dy = b.lat - a.lat;
+      const double length2 = dx * dx + dy * dy;
+      double t = 0;
+      if (length2 > 0) {
+        t = std::clamp(((point.lng - a.lng) * dx + (point.lat - a.lat) * dy) / length2, 0.0, 1.0);
+      }
+      return std::hypot(point.lng - (a.lng + t * dx), point.lat - (a.lat + t * dy));
+    }
+
+    // Упрощение ломаной по алгоритму Дугласа-Пекера, возвращает номера оставшихся остановок
+    std::vector<uint32_t> SimplifyRoute(const std::vector<const transcat::Stop *> &stops, double tolerance) {
+      const auto size = static_cast<uint32_t>(stops.size());
+      std::vector<uint32_t> kept;
+      if (size <= 2) {
+        for (uint32_t i = 0; i < size; ++i) {
+          kept.push_back(i);
+        }
+        return kept;
+      }
+      std::vector<bool> keep(size, false);
+      keep.front() = true;
+      keep.back() = true;
+      std::vector<std::pair<uint32_t, uint32_t>> ranges{{0, size - 1}};
+      while (!ranges.empty()) {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+        double max_distance = tolerance;
+        uint32_t farthest = first;
+        for (uint32_t i = first + 1; i < last; ++i) {
+          const double distance = DistanceToSegment(stops[i]->coords, stops[first]->coords, stops[last]->coords);
+          if (distance > max_distance) {
+            max_distance = distance;
+            farthest = i;
+          }
+        }
+        if (farthest != first) {
+          keep[farthest] = true;
+          ranges.emplace_back(first, farthest);
+          ranges.emplace_back(farthest, last);
+        }
+      }
+      for (uint32_t i = 0; i < size; ++i) {
+        if (keep[i]) {
+          kept.push_back(i);
+        }
+      }
+      return kept;
+    }
+
+    // Подложка и сам текст выводятся парой с одинаковыми координатами
+    void AddLabel(svg::Emitter &emitter, svg::Point point, const svg::TextStyle &text_style,
+                  const svg::PathStyle &underlayer_style, const svg::PathStyle &style, std::string_view data) {
+      emitter.AddText(point, text_style, underlayer_style, data);
+      emitter.AddText(point, text_style, style, data);
     }
   }
-  const transcat::SphereProjector
-      sp(coords.begin(), coords.end(), render_settings.width, render_settings.height, render_settings.padding);
-  return sp;
-}
 
 namespace transcat
   {
-    void MapRenderer::DrawPolylines(svg::Document &doc, const SphereProjector &sp) const {
-      const auto number_of_colors = render_settings_.color_palette.size();
-      size_t current_color = 0;
+    std::shared_ptr<const std::string> FragmentCache::Find(uint64_t key) {
+      const std::lock_guard guard(mutex_);
+      const auto it = index_.find(key);
+      if (it == index_.end()) {
+        return nullptr;
+      }
+      entries_.splice(entries_.begin(), entries_, it->second);
+      return it->second->second;
+    }
+
+    void FragmentCache::Insert(uint64_t key, std::shared_ptr<const std::string> fragment) {
+      if (fragment->size() > capacity_bytes_) {
+        return;
+      }
+      const std::lock_guard guard(mutex_);
+      if (index_.count(key) > 0) {
+        return;
+      }
+      size_bytes_ += fragment->size();
+      entries_.emplace_front(key, std::move(fragment));
+      index_.emplace(key, entries_.begin());
+      while (size_bytes_ > capacity_bytes_) {
+        const auto &oldest = entries_.back();
+        size_bytes_ -= oldest.second->size();
+        index_.erase(oldest.first);
+        entries_.pop_back();
+      }
+    }
+
+    MapRenderer::MapRenderer(const std::map<const std::string_view, const transcat::Bus *, std::less<>> &all_routes,
+                             const std::map<const std::string_view, const transcat::Stop *, std::less<>> &all_stops,
+                             const transcat::PassingBuses &all_passing_buses,
+                             const std::optional<geo::Bounds> &stops_bounds,
+                             const RenderSettings &render_settings)
+        : render_settings_(render_settings)
+        , projector_(stops_bounds, render_settings.width, render_settings.height, render_settings.padding)
+        , fragments_(kFragmentCacheBytes) {
+      // Линия каждого маршрута берёт следующий цвет палитры, а название — только маршрута с остановками
+      const auto number_of_colors = std::max<size_t>(render_settings_.color_palette.size(), 1);
+      size_t labels = 0;
+      routes_.reserve(all_routes.size());
+      for (const auto &[name, bus]: all_routes) {
+        routes_.push_back({name, bus, routes_.size() % number_of_colors, labels % number_of_colors});
+        if (!bus->route.stops.empty()) {
+          ++labels;
+        }
+      }
+      for (const auto &[name, stop]: all_stops) {
+        const auto buses_it = all_passing_buses.find(stop);
+        if (buses_it != all_passing_buses.cend() && !buses_it->second.empty()) {
+          stop_indices_.emplace(stop, static_cast<uint32_t>(stops_.size()));
+          stops_.push_back({name, stop});
+        }
+      }
+      size_t max_id = 0;
+      for (const auto &[name, stop]: stops_) {
+        max_id = std::max(max_id, stop->id);
+      }
+      projected_.resize(stops_.empty() ? 0 : max_id + 1);
+      for (const auto &[name, stop]: stops_) {
+        projected_[stop->id] = projector_(stop->coords);
+      }
+    }
+
+    void MapRenderer::DrawPolylines(svg::Emitter &emitter, size_t begin, size_t end,
+                                    const SimplifiedRoutes *simplified) const {
       const bool empty_palette = render_settings_.color_palette.empty();
-      for (const auto &[key, bus]: all_routes_) {
-        svg::Polyline polyline;
+      auto style = PolylineStyle(render_settings_);
+      for (size_t index = begin; index < end; ++index) {
+        const auto &bus = routes_[index].bus;
         const auto route_size = bus->route.stops.size();
         const auto &route = bus->route.stops;
+        emitter.StartPolyline();
         if (route_size == 1) {
-          polyline.AddPoint({render_settings_.padding, render_settings_.padding});
+          emitter.AddPoint({render_settings_.padding, render_settings_.padding});
 
+        } else if (route_size > 1 && simplified != nullptr) {
+          const auto &kept = (*simplified)[index];
+          for (const auto i: kept) {
+            emitter.AddPoint(projected_[route[i]->id]);
+          }
+          if (!bus->route.is_roundtrip) {
+            for (auto it = kept.rbegin() + 1; it != kept.rend(); ++it) {
+              emitter.AddPoint(projected_[route[*it]->id]);
+            }
+          }
         } else if (route_size > 1) {
           for (size_t i = 0; i < route_size; ++i) {
-            polyline.AddPoint(sp(route[i]->coords));
+            emitter.AddPoint(projected_[route[i]->id]);
           }
           if (!bus->route.is_roundtrip) {
             for (size_t i = route_size - 1; i > 0; --i) {
-              polyline.AddPoint(sp(route[i - 1]->coords));
+              emitter.AddPoint(projected_[route[i - 1]->id]);
             }
           }
         }
         if (!empty_palette) {
-          polyline.SetStrokeColor(render_settings_.color_palette[current_color++]);
+          style.stroke_color = &render_settings_.color_palette[routes_[index].line_color];
+        }
+        emitter.EndPolyline(style);
+      }
+    }
+    template<typename Project>
+    void MapRenderer::DrawRouteLabels(svg::Emitter &emitter, const Project &project, const MapRoute &route,
+                                      const svg::TextStyle &text_style, const svg::PathStyle &underlayer_style,
+                                      const geo::Bounds *bounds) const {
+      const auto &stops = route.bus->route.stops;
+      if (stops.empty()) {
+        return;
+      }
+      svg::PathStyle style;
+      if (!render_settings_.color_palette.empty()) {
+        style.fill_color = &render_settings_.color_palette[route.label_color];
+      }
+      const auto add_label = [&](const Stop *stop) {
+        if (bounds == nullptr || bounds->Contains(stop->coords)) {
+          AddLabel(emitter, project(stop), text_style, underlayer_style, style, route.name);
         }
-        SetPolylineSettings(polyline, render_settings_);
-        doc.Add(polyline);
-        if (current_color > number_of_colors - 1) {
-          current_color = 0;
+      };
+      const auto *const first_last_stop = stops.front();
+      const auto *const last_last_stop = stops.back();
+      add_label(first_last_stop);
+      if (!route.bus->route.is_roundtrip && first_last_stop != last_last_stop) {
+        add_label(last_last_stop);
+      }
+    }
+    void MapRenderer::DrawBusText(svg::Emitter &emitter, size_t begin, size_t end) const {
+      const auto text_style = BusTextStyle(render_settings_);
+      const auto underlayer_style = UnderlayerStyle(render_settings_);
+      const auto project = [this](const Stop *stop) {
+        return projected_[stop->id];
+      };
+      for (size_t index = begin; index < end; ++index) {
+        DrawRouteLabels(emitter, project, routes_[index], text_style, underlayer_style);
+      }
+    }
+    void MapRenderer::DrawCircles(svg::Emitter &emitter, size_t begin, size_t end) const {
+      svg::PathStyle style;
+      style.fill_color = &kStopColor;
+      for (size_t index = begin; index < end; ++index) {
+        emitter.AddCircle(projected_[stops_[index].stop->id], render_settings_.stop_radius, style);
+      }
+    }
+    void MapRenderer::DrawStopsText(svg::Emitter &emitter, size_t begin, size_t end) const {
+      const auto text_style = StopTextStyle(render_settings_);
+      const auto underlayer_style = UnderlayerStyle(render_settings_);
+      svg::PathStyle style;
+      style.fill_color = &kStopTextColor;
+      for (size_t index = begin; index < end; ++index) {
+        const auto &[name, stop] = stops_[index];
+        AddLabel(emitter, projected_[stop->id], text_style, underlayer_style, style, name);
+      }
+    }
+
+    const MapIndex &MapRenderer::GetIndex() const {
+      std::call_once(index_flag_, [this] {
+        index_ = std::make_unique<MapIndex>(routes_, stops_);
+      });
+      return *index_;
+    }
+
+    std::shared_ptr<const MapRenderer::SimplifiedRoutes> MapRenderer::GetSimplified(double zoom) const {
+      if (render_settings_.simplify_tolerance <= 0 || zoom <= 0) {
+        return nullptr;
+      }
+      const int level = static_cast<int>(std::ceil(std::log2(zoom)));
+      {
+        const std::lock_guard guard(simplified_mutex_);
+        const auto it = simplified_.find(level);
+        if (it != simplified_.end()) {
+          return it->second;
         }
       }
+      const double tolerance = render_settings_.simplify_tolerance / std::ldexp(1.0, level);
+      auto routes = std::make_shared<SimplifiedRoutes>(routes_.size());
+      tbb::parallel_for(size_t{0}, routes_.size(), [this, &routes, tolerance](size_t i) {
+        (*routes)[i] = SimplifyRoute(routes_[i].bus->route.stops, tolerance);
+      });
+      // При одновременном вычислении одного уровня остаётся первый результат
+      const std::lock_guard guard(simplified_mutex_);
+      return simplified_.emplace(level, std::move(routes)).first->second;
     }
-    void MapRenderer::DrawBusText(svg::Document &doc, const SphereProjector &sp) const {
-      size_t current_color_for_text = 0;
-      const auto number_of_colors = render_settings_.color_palette.size();
-      const bool empty_palette = render_settings_.color_palette.empty();
-      for (const auto &[key, bus]: all_routes_) {
-        const auto route_size = bus->route.stops.size();
-        const auto &route = bus->route;
-        if (route_size == 0) {
-          continue;
-        }
-        if (route.is_roundtrip) {
-          const auto *const stop = route.stops[0];
-          svg::Text text;
-          svg::Text text_layer;
-          SetTextSettings(text, key, sp(stop->coords), render_settings_);
-          SetTextSettings(text_layer, key, sp(stop->coords), render_settings_);
-          SetTextLayerSettings(text_layer, render_settings_);
-          if (!empty_palette) {
-            text.SetFillColor(render_settings_.color_palette[current_color_for_text++]);
+
+    std::shared_ptr<const std::string> MapRenderer::GetFragment(Layer layer, size_t index,
+                                                                const SimplifiedRoutes *simplified) const {
+      const uint64_t key = (static_cast<uint64_t>(layer) << 32) | index;
+      if (auto fragment = fragments_.Find(key)) {
+        return fragment;
+      }
+      std::string text;
+      svg::Emitter emitter(text, {render_settings_.coordinate_precision});
+      DrawChunk(emitter, {layer, index, index + 1}, simplified);
+      auto fragment = std::make_shared<const std::string>(std::move(text));
+      fragments_.Insert(key, fragment);
+      return fragment;
+    }
+
+    void MapRenderer::DrawBuses(const std::vector<std::string> &bus_names, std::string &out) const {
+      std::vector<uint32_t> routes;
+      for (const auto &bus_name: bus_names) {
+        const auto it = std::lower_bound(routes_.begin(), routes_.end(), bus_name,
+                                         [](const MapRoute &route, std::string_view name) {
+                                           return route.name < name;
+                                         });
+        if (it != routes_.end() && it->name == bus_name) {
+          routes.push_back(static_cast<uint32_t>(it - routes_.begin()));
+        }
+      }
+      std::sort(routes.begin(), routes.end());
+      routes.erase(std::unique(routes.begin(), routes.end()), routes.end());
+
+      std::vector<uint32_t> stops;
+      for (const auto route: routes) {
+        for (const auto *stop: routes_[route].bus->route.stops) {
+          stops.push_back(stop_indices_.at(stop));
+        }
+      }
+      std::sort(stops.begin(), stops.end());
+      stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+
+      const auto simplified = GetSimplified(projector_.GetZoom());
+      // Фрагменты удерживаются до конца сборки, даже если кеш успеет их вытеснить
+      std::vector<std::shared_ptr<const std::string>> parts;
+      parts.reserve(2 * (routes.size() + stops.size()));
+      for (const auto layer: {Layer::Polylines, Layer::BusText}) {
+        for (const auto route: routes) {
+          parts.push_back(GetFragment(layer, route, simplified.get()));
+        }
+      }
+      for (const auto layer: {Layer::Circles, Layer::StopsText}) {
+        for (const auto stop: stops) {
+          parts.push_back(GetFragment(layer, stop, simplified.get()));
+        }
+      }
+
+      size_t total_size = 0;
+      for (const auto &part: parts) {
+        total_size += part->size();
+      }
+      out.reserve(out.size() + total_size + kDocumentFrameSize);
+      svg::Emitter emitter(out, {render_settings_.coordinate_precision});
+      emitter.StartDocument();
+      for (const auto &part: parts) {
+        out += *part;
+      }
+      emitter.EndDocument();
+    }
+
+    void MapRenderer::DrawViewport(const geo::Bounds &bounds, std::string &out) const {
+      const auto &index = GetIndex();
+      const geo::Coordinates corners[] = {bounds.min, bounds.max};
+      const SphereProjector sp(std::begin(corners), std::end(corners),
+                               render_settings_.width, render_settings_.height, render_settings_.padding);
+      const auto simplified = GetSimplified(sp.GetZoom());
+      svg::Emitter emitter(out, {render_settings_.coordinate_precision});
+      emitter.StartDocument();
+
+      // Подряд идущие видимые отрезки маршрута выводятся одной ломаной
+      const auto segments = index.FindSegments(bounds);
+      auto line_style = PolylineStyle(render_settings_);
+      for (size_t first = 0; first < segments.size();) {
+        const auto &route = routes_[segments[first].route];
+        size_t last = first;
+        while (last + 1 < segments.size() && segments[last + 1].route == segments[first].route
+            && segments[last + 1].segment == segments[last].segment + 1) {
+          ++last;
+        }
+        if (!render_settings_.color_palette.empty()) {
+          line_style.stroke_color = &render_settings_.color_palette[route.line_color];
+        }
+        const auto &stops = route.bus->route.stops;
+        const size_t from = segments[first].segment;
+        const size_t to = std::min<size_t>(segments[last].segment + 1, stops.size() - 1);
+        emitter.StartPolyline();
+        if (simplified != nullptr) {
+          // Концы видимого участка сохраняются, внутри остаются только точки упрощённой ломаной
+          const auto &kept = (*simplified)[segments[first].route];
+          emitter.AddPoint(sp(stops[from]->coords));
+          for (auto it = std::upper_bound(kept.begin(), kept.end(), from); it != kept.end() && *it < to; ++it) {
+            emitter.AddPoint(sp(stops[*it]->coords));
           }
-          if (current_color_for_text > number_of_colors - 1) {
-            current_color_for_text = 0;
+          if (to != from) {
+            emitter.AddPoint(sp(stops[to]->coords));
           }
-          doc.Add(text_layer);
-          doc.Add(text);
         } else {
-          const auto *const first_last_stop = route.stops[0];
-          const auto *const last_last_stop = route.stops[route_size - 1];
-          svg::Text text;
-          svg::Text text_layer;
-          SetTextSettings(text, key, sp(first_last_stop->coords), render_settings_);
-          SetTextSettings(text_layer, key, sp(first_last_stop->coords), render_settings_);
-          SetTextLayerSettings(text_layer, render_settings_);
-          if (!empty_palette) {
-            text.SetFillColor(render_settings_.color_palette[current_color_for_text]);
-          }
-          doc.Add(text_layer);
-          doc.Add(text);
-          if (first_last_stop != last_last_stop) {
-            svg::Text text_last_stop;
-            svg::Text text_layer_last_stop;
-            SetTextSettings(text_last_stop, key, sp(last_last_stop->coords), render_settings_);
-            SetTextSettings(text_layer_last_stop, key, sp(last_last_stop->coords), render_settings_);
-            SetTextLayerSettings(text_layer_last_stop, render_settings_);
-            if (!empty_palette) {
-              text_last_stop.SetFillColor(render_settings_.color_palette[current_color_for_text]);
-            }
-            doc.Add(text_layer_last_stop);
-            doc.Add(text_last_stop);
-          }
-          ++current_color_for_text;
-          if (current_color_for_text > number_of_colors - 1) {
-            current_color_for_text = 0;
+          for (size_t i = from; i <= to; ++i) {
+            emitter.AddPoint(sp(stops[i]->coords));
           }
         }
+        emitter.EndPolyline(line_style);
+        first = last + 1;
       }
-    }
-    void MapRenderer::DrawCircles(svg::Document &doc, const SphereProjector &sp) const {
-      using namespace std::literals;
 
-      for (const auto &[name, stop]: all_stops_) {
-        const auto buses_it = all_passing_buses_.find(stop);
-        if (buses_it == all_passing_buses_.cend()) {
-          continue;
-        }
-        if (buses_it->second.empty()) {
-          continue;
+      const auto text_style = BusTextStyle(render_settings_);
+      const auto underlayer_style = UnderlayerStyle(render_settings_);
+      const auto project = [&sp](const Stop *stop) {
+        return sp(stop->coords);
+      };
+      for (size_t i = 0; i < segments.size(); ++i) {
+        if (i == 0 || segments[i].route != segments[i - 1].route) {
+          DrawRouteLabels(emitter, project, routes_[segments[i].route], text_style, underlayer_style, &bounds);
         }
+      }
 
-        svg::Circle circle;
-        circle.SetCenter(sp(stop->coords));
-        circle.SetRadius(render_settings_.stop_radius);
-        circle.SetFillColor("white"s);
-        doc.Add(circle);
+      const auto stops = index.FindStops(bounds);
+      svg::PathStyle circle_style;
+      circle_style.fill_color = &kStopColor;
+      for (const auto stop_index: stops) {
+        emitter.AddCircle(sp(stops_[stop_index].stop->coords), render_settings_.stop_radius, circle_style);
+      }
+      const auto stop_text_style = StopTextStyle(render_settings_);
+      svg::PathStyle stop_style;
+      stop_style.fill_color = &kStopTextColor;
+      for (const auto stop_index: stops) {
+        const auto &[name, stop] = stops_[stop_index];
+        AddLabel(emitter, sp(stop->coords), stop_text_style, underlayer_style, stop_style, name);
       }
+      emitter.EndDocument();
     }
-    void MapRenderer::DrawStopsText(svg::Document &doc, const SphereProjector &sp) const {
-      using namespace std::literals;
 
-      for (const auto &[name, stop]: all_stops_) {
-        const auto buses_it = all_passing_buses_.find(stop);
-        if (buses_it == all_passing_buses_.cend() || buses_it->second.empty()) {
-          continue;
-        }
-        svg::Text text;
-        svg::Text text_layer;
-        SetStopTextSettings(text, name, sp(stop->coords), render_settings_);
-        SetStopTextSettings(text_layer, name, sp(stop->coords), render_settings_);
-        SetStopTextLayerSettings(text_layer, render_settings_);
-        text.SetFillColor("black"s);
-        doc.Add(text_layer);
-        doc.Add(text);
+    void MapRenderer::DrawChunk(svg::Emitter &emitter, const Chunk &chunk, const SimplifiedRoutes *simplified) const {
+      switch (chunk.layer) {
+        case Layer::Polylines:
+          DrawPolylines(emitter, chunk.begin, chunk.end, simplified);
+          break;
+        case Layer::BusText:
+          DrawBusText(emitter, chunk.begin, chunk.end);
+          break;
+        case Layer::Circles:
+          DrawCircles(emitter, chunk.begin, chunk.end);
+          break;
+        case Layer::StopsText:
+          DrawStopsText(emitter, chunk.begin, chunk.end);
+          break;
       }
     }
 
-    svg::Document MapRenderer::DrawRoutes() const {
-      using namespace std::literals;
+    void MapRenderer::DrawRoutes(std::string &out) const {
+      const number_format::FloatFormat coordinate_format{render_settings_.coordinate_precision};
+      const auto simplified = GetSimplified(projector_.GetZoom());
+
+      std::vector<Chunk> chunks;
+      const auto add_chunks = [&chunks](Layer layer, size_t size, size_t chunk_size) {
+        for (size_t begin = 0; begin < size; begin += chunk_size) {
+          chunks.push_back({layer, begin, std::min(size, begin + chunk_size)});
+        }
+      };
+      add_chunks(Layer::Polylines, routes_.size(), kRoutesPerChunk);
+      add_chunks(Layer::BusText, routes_.size(), kRoutesPerChunk);
+      add_chunks(Layer::Circles, stops_.size(), kStopsPerChunk);
+      add_chunks(Layer::StopsText, stops_.size(), kStopsPerChunk);
 
-      svg::Document doc;
-      const auto sp = CreateSphereProjector(all_routes_, render_settings_);
-      DrawPolylines(doc, sp);
-      DrawBusText(doc, sp);
-      DrawCircles(doc, sp);
-      DrawStopsText(doc, sp);
+      std::vector<std::string> parts(chunks.size());
+      tbb::parallel_for(size_t{0}, chunks.size(), [&](size_t i) {
+        svg::Emitter emitter(parts[i], coordinate_format);
+        DrawChunk(emitter, chunks[i], simplified.get());
+      });
 
-      return doc;
+      size_t total_size = 0;
+      for (const auto &part: parts) {
+        total_size += part.size();
+      }
+      out.reserve(out.size() + total_size + kDocumentFrameSize);
+      svg::Emitter emitter(out, coordinate_format);
+      emitter.StartDocument();
+      for (const auto &part: parts) {
+        out += part;
+      }
+      emitter.EndDocument();
     }
 
-  }
+  }
\ No newline at end of file
@@ -2,10 +2,19 @@
 
 #include <algorithm>
 #include <cmath>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "domain.h"
 #include "geo.h"
+#include "map_index.h"
 #include "svg.h"
 
 namespace detail
@@ -27,31 +36,25 @@ namespace transcat {
       svg::Color underlayer_color;
       double underlayer_width;
       std::vector<svg::Color> color_palette;
+      // Значащих цифр в координатах SVG, number_format::FloatFormat::kShortest — кратчайшая точная запись
+      int coordinate_precision = number_format::FloatFormat::kDefaultPrecision;
+      // Допуск упрощения ломаных маршрутов в пикселях, 0 — ломаные выводятся по всем остановкам
+      double simplify_tolerance = 0.0;
     };
 
     class SphereProjector {
      public:
-      template<typename PointInputIt>
-      SphereProjector(PointInputIt points_begin, PointInputIt points_end, double max_width,
-                      double max_height, double padding)
+      // Проекция области bounds на холст; без области все точки попадают в (padding, padding)
+      SphereProjector(const std::optional<geo::Bounds> &bounds, double max_width, double max_height, double padding)
           : padding_(padding) {
-        if (points_begin == points_end) {
+        if (!bounds) {
           return;
         }
 
-        const auto[left_it, right_it]
-        = std::minmax_element(points_begin, points_end, [](auto lhs, auto rhs) {
-          return lhs.lng < rhs.lng;
-        });
-        min_lon_ = left_it->lng;
-        const double max_lon = right_it->lng;
-
-        const auto[bottom_it, top_it]
-        = std::minmax_element(points_begin, points_end, [](auto lhs, auto rhs) {
-          return lhs.lat < rhs.lat;
-        });
-        const double min_lat = bottom_it->lat;
-        max_lat_ = top_it->lat;
+        min_lon_ = bounds->min.lng;
+        const double max_lon = bounds->max.lng;
+        const double min_lat = bounds->min.lat;
+        max_lat_ = bounds->max.lat;
 
         std::optional<double> width_zoom;
         if (!detail::IsZero(max_lon - min_lon_)) {
@@ -72,41 +75,142 @@ namespace transcat {
         }
       }
 
+      template<typename PointInputIt>
+      SphereProjector(PointInputIt points_begin, PointInputIt points_end, double max_width,
+                      double max_height, double padding)
+          : SphereProjector(ComputeBounds(points_begin, points_end), max_width, max_height, padding) {
+      }
+
       svg::Point operator()(geo::Coordinates coords) const {
         return {
             (coords.lng - min_lon_) * zoom_coeff_ + padding_, (max_lat_ - coords.lat) * zoom_coeff_ + padding_
         };
       }
 
+      // Число пикселей на градус
+      double GetZoom() const {
+        return zoom_coeff_;
+      }
+
      private:
+      template<typename PointInputIt>
+      static std::optional<geo::Bounds> ComputeBounds(PointInputIt points_begin, PointInputIt points_end) {
+        if (points_begin == points_end) {
+          return std::nullopt;
+        }
+        const auto[left_it, right_it]
+        = std::minmax_element(points_begin, points_end, [](auto lhs, auto rhs) {
+          return lhs.lng < rhs.lng;
+        });
+        const auto[bottom_it, top_it]
+        = std::minmax_element(points_begin, points_end, [](auto lhs, auto rhs) {
+          return lhs.lat < rhs.lat;
+        });
+        return geo::Bounds{{bottom_it->lat, left_it->lng}, {top_it->lat, right_it->lng}};
+      }
+
       double padding_;
       double min_lon_ = 0;
       double max_lat_ = 0;
       double zoom_coeff_ = 0;
     };
 
-    class MapRenderer {
+    /*
+     * Ограниченный по суммарному размеру LRU-кеш готовых SVG-фрагментов карты.
+     * Методы потокобезопасны
+     */
+    class FragmentCache {
      public:
-      explicit MapRenderer(std::map<const std::string_view, const transcat::Bus *, std::less<>> all_routes,
-                           std::map<const std::string_view, const transcat::Stop *, std::less<>> all_stops,
-                           const transcat::PassingBuses &all_passing_buses,
-                           const RenderSettings &render_settings)
-          : all_routes_(std::move(all_routes))
-          , all_stops_(std::move(all_stops))
-          , all_passing_buses_(all_passing_buses)
-          , render_settings_(render_settings) {
+      explicit FragmentCache(size_t capacity_bytes)
+          : capacity_bytes_(capacity_bytes) {
       }
 
-      svg::Document DrawRoutes() const;
+      std::shared_ptr<const std::string> Find(uint64_t key);
+      void Insert(uint64_t key, std::shared_ptr<const std::string> fragment);
+
      private:
-      void DrawPolylines(svg::Document &doc, const SphereProjector &sp) const;
-      void DrawBusText(svg::Document &doc, const SphereProjector &sp) const;
-      void DrawCircles(svg::Document &doc, const SphereProjector &sp) const;
-      void DrawStopsText(svg::Document &doc, const SphereProjector &sp) const;
-
-      const std::map<const std::string_view, const transcat::Bus *, std::less<>> all_routes_;
-      const std::map<const std::string_view, const transcat::Stop *, std::less<>> all_stops_;
-      const transcat::PassingBuses &all_passing_buses_;
+      using Entry = std::pair<uint64_t, std::shared_ptr<const std::string>>;
+
+      std::mutex mutex_;
+      size_t capacity_bytes_;
+      size_t size_bytes_ = 0;
+      // Недавно использованные записи в начале списка
+      std::list<Entry> entries_;
+      std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    };
+
+    class MapRenderer {
+     public:
+      MapRenderer(const std::map<const std::string_view, const transcat::Bus *, std::less<>> &all_routes,
+                  const std::map<const std::string_view, const transcat::Stop *, std::less<>> &all_stops,
+                  const transcat::PassingBuses &all_passing_buses,
+                  const std::optional<geo::Bounds> &stops_bounds,
+                  const RenderSettings &render_settings);
+
+      // Дописывает SVG-документ карты в конец out.
+      // Слои и их участки отрисовываются параллельно и склеиваются в исходном порядке
+      void DrawRoutes(std::string &out) const;
+      // Дописывает в out карту области bounds: только видимые остановки, отрезки маршрутов и надписи.
+      // Проекция строится по углам области, цвета маршрутов совпадают с полной картой
+      void DrawViewport(const geo::Bounds &bounds, std::string &out) const;
+      /*
+       * Дописывает в out карту только перечисленных маршрутов и их остановок в проекции полной карты.
+       * Карта собирается из фрагментов отдельных маршрутов и остановок, которые отрисовываются
+       * при первом обращении и хранятся в ограниченном кеше. Неизвестные названия пропускаются
+       */
+      void DrawBuses(const std::vector<std::string> &bus_names, std::string &out) const;
+     private:
+      enum class Layer {
+        Polylines,
+        BusText,
+        Circles,
+        StopsText
+      };
+
+      // Участок слоя: элементы [begin, end) из routes_ или stops_
+      struct Chunk {
+        Layer layer;
+        size_t begin;
+        size_t end;
+      };
+
+      // Для каждого маршрута — возрастающие номера остановок, оставшихся в упрощённой ломаной
+      using SimplifiedRoutes = std::vector<std::vector<uint32_t>>;
+
+      // Слои полной карты берут координаты остановок из projected_
+      void DrawChunk(svg::Emitter &emitter, const Chunk &chunk, const SimplifiedRoutes *simplified) const;
+      void DrawPolylines(svg::Emitter &emitter, size_t begin, size_t end, const SimplifiedRoutes *simplified) const;
+      void DrawBusText(svg::Emitter &emitter, size_t begin, size_t end) const;
+      void DrawCircles(svg::Emitter &emitter, size_t begin, size_t end) const;
+      void DrawStopsText(svg::Emitter &emitter, size_t begin, size_t end) const;
+      // Надписи маршрута у конечных остановок; при bounds != nullptr — только у попавших в область.
+      // project(const Stop *) возвращает точку остановки на холсте
+      template<typename Project>
+      void DrawRouteLabels(svg::Emitter &emitter, const Project &project, const MapRoute &route,
+                           const svg::TextStyle &text_style, const svg::PathStyle &underlayer_style,
+                           const geo::Bounds *bounds = nullptr) const;
+      std::shared_ptr<const std::string> GetFragment(Layer layer, size_t index,
+                                                     const SimplifiedRoutes *simplified) const;
+      // Индекс строится при первом запросе области
+      const MapIndex &GetIndex() const;
+      /*
+       * Упрощённые ломаные для масштаба zoom или nullptr, если упрощение выключено.
+       * Масштаб округляется вверх до степени двойки, поэтому отклонение не превышает
+       * simplify_tolerance пикселей, а результат для каждой степени вычисляется один раз
+       */
+      std::shared_ptr<const SimplifiedRoutes> GetSimplified(double zoom) const;
+
+      std::vector<MapRoute> routes_;
+      std::vector<MapStop> stops_;
+      std::unordered_map<const Stop *, uint32_t> stop_indices_;
       const RenderSettings &render_settings_;
+      // Проекция полной карты и точки всех остановок с маршрутами в ней, по идентификатору остановки
+      SphereProjector projector_;
+      std::vector<svg::Point> projected_;
+      mutable FragmentCache fragments_;
+      mutable std::once_flag index_flag_;
+      mutable std::unique_ptr<MapIndex> index_;
+      mutable std::mutex simplified_mutex_;
+      mutable std::unordered_map<int, std::shared_ptr<const SimplifiedRoutes>> simplified_;
     };
 }
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "name_index.h"
+
+#include <algorithm>
+
+namespace transcat
+  {
+    namespace
+      {
+        /*
+         * Нечёткий поиск по дереву: для каждого узла считается строка матрицы Левенштейна
+         * между искомым префиксом и путём до узла. Расстояние до названия — минимум последнего
+         * столбца по всем узлам пути, поддеревья без шансов попасть в результат отсекаются
+         */
+        class FuzzySearch {
+         public:
+          FuzzySearch(const NameIndex &index, std::string_view prefix, size_t limit, size_t max_edits)
+              : nodes_(index.GetNodes())
+              , edges_(index.GetEdges())
+              , prefix_(prefix)
+              , limit_(limit)
+              , max_edits_(max_edits)
+              , width_(prefix.size() + 1) {
+          }
+
+          std::vector<NameMatch> Run() {
+            rows_.resize(width_);
+            for (size_t j = 0; j < width_; ++j) {
+              rows_[j] = j;
+            }
+            Visit(0, 0, prefix_.size());
+            return std::move(result_);
+          }
+
+         private:
+          bool Threshold(size_t &threshold) const {
+            if (result_.size() < limit_) {
+              threshold = max_edits_;
+              return true;
+            }
+            if (result_.back().distance == 0) {
+              return false;
+            }
+            threshold = result_.back().distance - 1;
+            return true;
+          }
+
+          void AddMatch(uint8_t kinds, size_t distance) {
+            const auto it = std::upper_bound(result_.begin(), result_.end(), distance,
+                                             [](size_t lhs, const NameMatch &rhs) {
+                                               return lhs < rhs.distance;
+                                             });
+            result_.insert(it, NameMatch{path_, kinds, distance});
+            if (result_.size() > limit_) {
+              result_.pop_back();
+            }
+          }
+
+          void Visit(uint32_t node_id, size_t depth, size_t best) {
+            size_t threshold = 0;
+            if (!Threshold(threshold)) {
+              return;
+            }
+            const auto &node = nodes_[node_id];
+            if (node.kinds != 0 && best <= threshold) {
+              AddMatch(node.kinds, best);
+              if (!Threshold(threshold)) {
+                return;
+              }
+            }
+            const size_t row = depth * width_;
+            if (best > threshold && *std::min_element(rows_.begin() + row, rows_.begin() + row + width_) > threshold) {
+              return;
+            }
+            rows_.resize(std::max(rows_.size(), row + 2 * width_));
+            const size_t next = row + width_;
+            for (uint32_t e = node.first_edge; e < node.first_edge + node.edge_count; ++e) {
+              const char label = edges_[e].label;
+              rows_[next] = rows_[row] + 1;
+              for (size_t j = 1; j < width_; ++j) {
+                const size_t substitution = rows_[row + j - 1] + (prefix_[j - 1] == label ? 0 : 1);
+                rows_[next + j] = std::min({rows_[row + j] + 1, rows_[next + j - 1] + 1, substitution});
+              }
+              path_.push_back(label);
+              Visit(edges_[e].child, depth + 1, std::min(best, rows_[next + width_ - 1]));
+              path_.pop_back();
+            }
+          }
+
+          const std::vector<NameIndex::TrieNode> &nodes_;
+          const std::vector<NameIndex::TrieEdge> &edges_;
+          std::string_view prefix_;
+          size_t limit_;
+          size_t max_edits_;
+          size_t width_;
+          std::vector<size_t> rows_;
+          std::string path_;
+          std::vector<NameMatch> result_;
+        };
+      }
+
+    NameIndex::NameIndex(const TransportCatalogue &tc) {
+      std::vector<std::pair<std::string_view, uint8_t>> names;
+      names.reserve(tc.GetAllStops().size() + tc.GetAllRoutes().size());
+      for (const auto &[name, stop]: tc.GetAllStops()) {
+        names.emplace_back(name, STOP_NAME);
+      }
+      for (const auto &[name, bus]: tc.GetAllRoutes()) {
+        names.emplace_back(name, BUS_NAME);
+      }
+      std::sort(names.begin(), names.end());
+      std::vector<std::pair<std::string_view, uint8_t>> unique_names;
+      unique_names.reserve(names.size());
+      for (const auto &[name, kind]: names) {
+        if (!unique_names.empty() && unique_names.back().first == name) {
+          unique_names.back().second |= kind;
+        } else {
+          unique_names.emplace_back(name, kind);
+        }
+      }
+      Build(unique_names, 0, unique_names.size(), 0);
+    }
+
+    uint32_t NameIndex::Build(const std::vector<std::pair<std::string_view, uint8_t>> &names,
+                              size_t begin, size_t end, size_t depth) {
+      const auto node_id = static_cast<uint32_t>(nodes_.size());
+      nodes_.emplace_back();
+      if (begin < end && names[begin].first.size() == depth) {
+        nodes_[node_id].kinds = names[begin].second;
+        ++begin;
+      }
+
+      std::vector<std::pair<char, size_t>> groups;
+      for (size_t i = begin; i < end; ++i) {
+        const char label = names[i].first[depth];
+        if (groups.empty() || groups.back().first != label) {
+          groups.emplace_back(label, i);
+        }
+      }
+
+      const auto first_edge = static_cast<uint32_t>(edges_.size());
+      nodes_[node_id].first_edge = first_edge;
+      nodes_[node_id].edge_count = static_cast<uint32_t>(groups.size());
+      edges_.resize(edges_.size() + groups.size());
+      for (size_t g = 0; g < groups.size(); ++g) {
+        const size_t group_end = (g + 1 < groups.size()) ? groups[g + 1].second : end;
+        const uint32_t child = Build(names, groups[g].second, group_end, depth + 1);
+        edges_[first_edge + g] = {groups[g].first, child};
+      }
+      return node_id;
+    }
+
+    void NameIndex::CollectExact(uint32_t node_id, std::string &path, size_t limit,
+                                 std::vector<NameMatch> &result) const {
+      const auto &node = nodes_[node_id];
+      if (node.kinds != 0) {
+        result.push_back({path, node.kinds, 0});
+      }
+      for (uint32_t e = node.first_edge; e < node.first_edge + node.edge_count && result.size() < limit; ++e) {
+        path.push_back(edges_[e].label);
+        CollectExact(edges_[e].child, path, limit, result);
+        path.pop_back();
+      }
+    }
+
+    std::vector<NameMatch> NameIndex::Complete(std::string_view prefix, size_t limit, size_t max_edits) const {
+      std::vector<NameMatch> result;
+      if (nodes_.empty() || limit == 0) {
+        return result;
+      }
+      if (max_edits > 0) {
+        return FuzzySearch(*this, prefix, limit, max_edits).Run();
+      }
+
+      uint32_t node_id = 0;
+      for (const char c: prefix) {
+        const auto &node = nodes_[node_id];
+        const auto first = edges_.begin() + node.first_edge;
+        const auto last = first + node.edge_count;
+        const auto it = std::lower_bound(first, last, c, [](const TrieEdge &edge, char label) {
+          return static_cast<unsigned char>(edge.label) < static_cast<unsigned char>(label);
+        });
+        if (it == last || it->label != c) {
+          return result;
+        }
+        node_id = it->child;
+      }
+      std::string path(prefix);
+      CollectExact(node_id, path, limit, result);
+      return result;
+    }
+  }
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace transcat
+  {
+    enum NameKind : uint8_t {
+      STOP_NAME = 1,
+      BUS_NAME = 2
+    };
+
+    struct NameMatch {
+      std::string name;
+      uint8_t kinds;
+      size_t distance;
+    };
+
+    /*
+     * Компактное префиксное дерево по названиям остановок и маршрутов.
+     * Узлы хранятся в порядке обхода в глубину, дуги каждого узла отсортированы по символу,
+     * поэтому обход дерева выдаёт названия в лексикографическом порядке
+     */
+    class NameIndex {
+     public:
+      struct TrieNode {
+        uint32_t first_edge = 0;
+        uint32_t edge_count = 0;
+        uint8_t kinds = 0;
+      };
+
+      struct TrieEdge {
+        char label;
+        uint32_t child;
+      };
+
+      NameIndex() = default;
+      explicit NameIndex(const TransportCatalogue &tc);
+
+      // Возвращает не более limit названий, начинающихся с prefix с точностью до max_edits правок
+      std::vector<NameMatch> Complete(std::string_view prefix, size_t limit, size_t max_edits = 0) const;
+
+      bool IsEmpty() const {
+        return nodes_.empty();
+      }
+      const std::vector<TrieNode> &GetNodes() const {
+        return nodes_;
+      }
+      const std::vector<TrieEdge> &GetEdges() const {
+        return edges_;
+      }
+      void SetTrie(std::vector<TrieNode> nodes, std::vector<TrieEdge> edges) {
+        nodes_ = std::move(nodes);
+        edges_ = std::move(edges);
+      }
+     private:
+      uint32_t Build(const std::vector<std::pair<std::string_view, uint8_t>> &names,
+                     size_t begin, size_t end, size_t depth);
+      void CollectExact(uint32_t node, std::string &path, size_t limit, std::vector<NameMatch> &result) const;
+
+      std::vector<TrieNode> nodes_;
+      std::vector<TrieEdge> edges_;
+    };
+  }
@@ -0,0 +1,23 @@
+#include "number_format.h"
+
+#include <system_error>
+
+namespace number_format
+  {
+    char *ToChars(char *first, double value, FloatFormat format) {
+      // Формат general с заданной точностью совпадает с выводом через std::ostream, но не зависит от локали
+      const auto result = format.precision == FloatFormat::kShortest
+                          ? std::to_chars(first, first + kMaxChars, value)
+                          : std::to_chars(first, first + kMaxChars, value, std::chars_format::general, format.precision);
+      if (result.ec != std::errc{}) {
+        // Кратчайшая запись помещается в буфер всегда
+        return std::to_chars(first, first + kMaxChars, value).ptr;
+      }
+      return result.ptr;
+    }
+
+    char *ToChars(char *first, int value) {
+      const auto result = std::to_chars(first, first + kMaxChars, value);
+      return result.ec == std::errc{} ? result.ptr : first;
+    }
+  }
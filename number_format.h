@@ -0,0 +1,51 @@
+#pragma once
+
+#include <charconv>
+#include <iostream>
+#include <string>
+
+namespace number_format
+  {
+    /*
+     * Профиль вывода чисел с плавающей точкой.
+     * precision — число значащих цифр в формате %g, по умолчанию 6, как при выводе double через std::ostream.
+     * kShortest — кратчайшая запись, по которой число восстанавливается без потерь.
+     * Больше kMaxPrecision значащих цифр double не содержит, такая запись уже не помещается в kMaxChars
+     */
+    struct FloatFormat {
+      static constexpr int kDefaultPrecision = 6;
+      static constexpr int kShortest = -1;
+      static constexpr int kMaxPrecision = 17;
+
+      int precision = kDefaultPrecision;
+    };
+
+    // Размер буфера, достаточный для любого числа, выводимого функциями ниже
+    inline constexpr size_t kMaxChars = 32;
+
+    // Записывает число в буфер [first, first + kMaxChars) и возвращает указатель на конец записи
+    char *ToChars(char *first, double value, FloatFormat format = {});
+    char *ToChars(char *first, int value);
+
+    template<typename Number>
+    void Append(std::string &out, Number value) {
+      char chars[kMaxChars];
+      out.append(chars, ToChars(chars, value));
+    }
+
+    inline void Append(std::string &out, double value, FloatFormat format) {
+      char chars[kMaxChars];
+      out.append(chars, ToChars(chars, value, format));
+    }
+
+    template<typename Number>
+    void Write(std::ostream &out, Number value) {
+      char chars[kMaxChars];
+      out.write(chars, ToChars(chars, value) - chars);
+    }
+
+    inline void Write(std::ostream &out, double value, FloatFormat format) {
+      char chars[kMaxChars];
+      out.write(chars, ToChars(chars, value, format) - chars);
+    }
+  }
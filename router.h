@@ -6,6 +6,7 @@
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <memory>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -20,6 +21,19 @@ namespace graph
       std::optional<EdgeId> prev_edge;
     };
 
+    /*
+     * Матрица маршрутов, хранящаяся вне маршрутизатора построчно, например в отображённом
+     * в память файле базы. prev_edges: -1 — путь из вершины в саму себя, -2 — вершина недостижима
+     */
+    template<typename Weight>
+    struct RoutesMatrixView {
+      size_t vertex_count = 0;
+      const Weight *weights = nullptr;
+      const int32_t *prev_edges = nullptr;
+      // Владелец памяти, на которую указывают weights и prev_edges
+      std::shared_ptr<const void> storage;
+    };
+
     template<typename Weight>
     class Router {
      private:
@@ -29,6 +43,8 @@ namespace graph
       using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData<Weight>>>>;
       explicit Router(const Graph &graph);
       explicit Router(const Graph &graph, RoutesInternalData &&routes_internal_data);
+      // Маршрутизатор читает готовую матрицу на месте, не копируя её
+      explicit Router(const Graph &graph, RoutesMatrixView<Weight> matrix);
 
       struct RouteInfo {
         Weight weight;
@@ -42,6 +58,22 @@ namespace graph
       }
 
      private:
+      std::optional<RouteInternalData<Weight>> GetRouteInternalData(VertexId from, VertexId to) const {
+        if (!matrix_.weights) {
+          return routes_internal_data_.at(from).at(to);
+        }
+        if (from >= matrix_.vertex_count || to >= matrix_.vertex_count) {
+          throw std::out_of_range("Vertex is out of the routes matrix");
+        }
+        const size_t cell = from * matrix_.vertex_count + to;
+        const int32_t prev_edge = matrix_.prev_edges[cell];
+        if (prev_edge == -2) {
+          return std::nullopt;
+        }
+        return RouteInternalData<Weight>{
+            matrix_.weights[cell], prev_edge == -1 ? std::nullopt : std::optional<EdgeId>(prev_edge)};
+      }
+
       void InitializeRoutesInternalData(const Graph &graph) {
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
@@ -85,6 +117,7 @@ namespace graph
       static constexpr Weight ZERO_WEIGHT{};
       const Graph &graph_;
       RoutesInternalData routes_internal_data_;
+      RoutesMatrixView<Weight> matrix_;
     };
 
     template<typename Weight>
@@ -94,6 +127,25 @@ namespace graph
 
     }
 
+    template<typename Weight>
+    Router<Weight>::Router(const Graph &graph, RoutesMatrixView<Weight> matrix)
+        : graph_(graph)
+        , matrix_(std::move(matrix)) {
+      // Матрица читается из файла без разбора, поэтому ссылки на рёбра проверяются один раз здесь,
+      // чтобы повреждённая база не приводила к чтению за пределами рёбер графа
+      // Сдвиг на 2 переводит допустимые значения -2, -1, 0 .. edge_count - 1 в один беззнаковый диапазон,
+      // и проверка ячейки сводится к одному сравнению без ветвлений
+      const auto limit = static_cast<uint32_t>(std::min<size_t>(graph.GetEdgeCount(), INT32_MAX) + 2);
+      const size_t cells = matrix_.vertex_count * matrix_.vertex_count;
+      uint32_t invalid = matrix_.vertex_count != graph.GetVertexCount();
+      for (size_t cell = 0; cell < cells; ++cell) {
+        invalid |= static_cast<uint32_t>(matrix_.prev_edges[cell]) + 2u >= limit;
+      }
+      if (invalid != 0) {
+        throw std::runtime_error("Routes matrix does not match the graph");
+      }
+    }
+
     template<typename Weight>
     Router<Weight>::Router(const Graph &graph)
         : graph_(graph)
@@ -117,16 +169,20 @@ namespace graph
     template<typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                                  VertexId to) const {
-      const auto &route_internal_data = routes_internal_data_.at(from).at(to);
+      const auto route_internal_data = GetRouteInternalData(from, to);
       if (!route_internal_data) {
         return std::nullopt;
       }
       const Weight weight = route_internal_data->weight;
       std::vector<EdgeId> edges;
-      for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-           edge_id;
-           edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge) {
+      for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge; edge_id;) {
         edges.push_back(*edge_id);
+        const auto previous = GetRouteInternalData(from, graph_.GetEdge(*edge_id).from);
+        // Путь длиннее числа рёбер означает цикл в матрице
+        if (!previous || edges.size() > graph_.GetEdgeCount()) {
+          throw std::runtime_error("Routes matrix is inconsistent");
+        }
+        edge_id = previous->prev_edge;
       }
       std::reverse(edges.begin(), edges.end());
 
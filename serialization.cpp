@@ -1,17 +1,22 @@
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <utility>
 
+#include "base_file.h"
 #include "serialization.h"
 #include "transport_router.h"
 
 #include <graph.pb.h>
 #include <map_renderer.pb.h>
+#include <name_index.pb.h>
 #include <svg.pb.h>
 #include <transport_catalogue.pb.h>
 #include <transport_router.pb.h>
@@ -22,7 +27,7 @@ transport_catalogue_serialize::StopsList SerializeStops(const transcat::Transpor
   int id = 0;
   for (const auto &stop: transport_catalogue.GetAllStops()) {
     transport_catalogue_serialize::Stop serialized_stop;
-    serialized_stop.set_name(stop.second->name);
+    serialized_stop.set_name(std::string(stop.second->name));
     serialized_stop.set_coordinates_lat(stop.second->coords.lat);
     serialized_stop.set_coordinates_lng(stop.second->coords.lng);
     auto *new_stop = stops_list.add_stops();
@@ -44,7 +49,7 @@ transport_catalogue_serialize::BusesList SerializeBuses(const transcat::Transpor
   for (const auto &bus: transport_catalogue.GetAllRoutes()) {
     transport_catalogue_serialize::Bus serialized_bus;
     bus_id_list.insert({bus.second->name, bus_id++});
-    serialized_bus.set_name(bus.second->name);
+    serialized_bus.set_name(std::string(bus.second->name));
     serialized_bus.set_is_roundtrip(bus.second->route.is_roundtrip);
     for (const auto *const stop: bus.second->route.stops) {
       transport_catalogue_serialize::Stop serialized_stop;
@@ -113,6 +118,8 @@ transport_catalogue_serialize::Render_settings SerializeRenderSettings(const tra
   serialized_render_settings.add_stop_label_offset(render_settings.stop_label_offset[1]);
   *serialized_render_settings.mutable_underlayer_color() = SerializeColor(render_settings.underlayer_color);
   serialized_render_settings.set_underlayer_width(render_settings.underlayer_width);
+  serialized_render_settings.set_coordinate_precision(render_settings.coordinate_precision);
+  serialized_render_settings.set_simplify_tolerance(render_settings.simplify_tolerance);
   for (const auto &color: render_settings.color_palette) {
     auto *new_color = serialized_render_settings.add_color_palette();
     *new_color = SerializeColor(color);
@@ -140,13 +147,13 @@ transport_catalogue_serialize::Edge SerializeEdge(const graph::Edge<Minutes> &ed
   serialized_edge.set_from(edge.from);
   serialized_edge.set_to(edge.to);
   serialized_edge.set_weight(edge.weight);
-  if (!edge.bus_name.empty()) {
-    const auto bus_it = bus_id_list.find(edge.bus_name);
+  if (edge.bus != graph::kNoBus) {
+    const auto bus_it = bus_id_list.find(transport_catalogue.GetBus(edge.bus)->name);
     serialized_edge.set_bus_id(bus_it->second);
   } else {
     serialized_edge.set_bus_id(0);
   }
-  const auto stop_it = stop_id_list.find(transport_catalogue.FindStop(edge.stop_name));
+  const auto stop_it = stop_id_list.find(transport_catalogue.GetStop(edge.stop));
   serialized_edge.set_stop_id(stop_it->second);
   serialized_edge.set_span_count(edge.span_count);
 
@@ -168,11 +175,10 @@ transport_catalogue_serialize::Graph SerializeGraph(const transcat::TransportCat
     auto *new_edge = serialized_graph.add_edges();
     *new_edge = SerializeEdge(graph.GetEdge(i), transport_catalogue, stop_id_list, bus_id_list);
   }
-  const auto &incidence_lists = graph.GetIncidenceLists();
-  for (const auto &list: incidence_lists) {
+  for (size_t vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
     auto *new_serialized_incidence_list = serialized_graph.add_incidence_lists();
     transport_catalogue_serialize::IncidenceList serialized_incidence_list;
-    for (const auto &edge_id: list) {
+    for (const auto edge_id: graph.GetIncidentEdges(vertex)) {
       serialized_incidence_list.add_edge_id(edge_id);
     }
     *new_serialized_incidence_list = std::move(serialized_incidence_list);
@@ -180,31 +186,38 @@ transport_catalogue_serialize::Graph SerializeGraph(const transcat::TransportCat
   return serialized_graph;
 }
 
+namespace
+  {
+    // Значение prev_edge_id в упакованной матрице маршрутов для пути из вершины в саму себя,
+    // меньшие значения кодируют серии недостижимых вершин
+    constexpr int32_t kNoPrevEdge = -1;
+  }
+
 void SerializeRoutesInternalData(const std::shared_ptr<transcat::TransportRouter>& transport_router,
                                  transport_catalogue_serialize::TransportRouter &serialized_transport_router) {
   const auto router = transport_router->GetRouter();
-  for (const auto &routes_internal_data: router->GetRoutesInternalData()) {
-    transport_catalogue_serialize::RoutesInternalData serialized_routes_internal_data;
-    for (const auto &optional_rid: routes_internal_data) {
-      transport_catalogue_serialize::optionalRID serialized_optional_rid;
-      if (optional_rid.has_value()) {
-        transport_catalogue_serialize::RID serialized_rid;
-        serialized_rid.set_weight(optional_rid.value().weight);
-        if (optional_rid.value().prev_edge.has_value()) {
-          serialized_rid.set_prev_edge_id(optional_rid.value().prev_edge.value());
-        } else {
-          serialized_rid.set_prev_edge_id(-1);
-        }
-        serialized_optional_rid.set_no_value(false);
-        *serialized_optional_rid.mutable_rid_value() = std::move(serialized_rid);
-      } else {
-        serialized_optional_rid.set_no_value(true);
+  const auto &routes_internal_data = router->GetRoutesInternalData();
+  serialized_transport_router.set_vertex_count(static_cast<uint32_t>(routes_internal_data.size()));
+  auto *weights = serialized_transport_router.mutable_route_weights();
+  auto *prev_edge_ids = serialized_transport_router.mutable_route_prev_edge_ids();
+  for (const auto &row: routes_internal_data) {
+    int32_t unreachable = 0;
+    for (const auto &optional_rid: row) {
+      if (!optional_rid.has_value()) {
+        ++unreachable;
+        continue;
       }
-      auto *new_optional_rid = serialized_routes_internal_data.add_optional_rid();
-      *new_optional_rid = std::move(serialized_optional_rid);
+      if (unreachable > 0) {
+        prev_edge_ids->Add(kNoPrevEdge - unreachable);
+        unreachable = 0;
+      }
+      weights->Add(optional_rid->weight);
+      prev_edge_ids->Add(optional_rid->prev_edge.has_value() ? static_cast<int32_t>(*optional_rid->prev_edge)
+                                                             : kNoPrevEdge);
+    }
+    if (unreachable > 0) {
+      prev_edge_ids->Add(kNoPrevEdge - unreachable);
     }
-    auto *new_routes_internal_data = serialized_transport_router.add_routes_internal_data();
-    *new_routes_internal_data = std::move(serialized_routes_internal_data);
   }
 }
 
@@ -244,15 +257,163 @@ transport_catalogue_serialize::TransportRouter SerializeTransportRouter(const tr
   return serialized_transport_router;
 }
 
+transport_catalogue_serialize::NameIndex SerializeNameIndex(const transcat::NameIndex &name_index) {
+  transport_catalogue_serialize::NameIndex serialized_name_index;
+  for (const auto &node: name_index.GetNodes()) {
+    serialized_name_index.add_first_edge(node.first_edge);
+    serialized_name_index.add_edge_count(node.edge_count);
+    serialized_name_index.add_kinds(node.kinds);
+  }
+  std::string labels;
+  labels.reserve(name_index.GetEdges().size());
+  for (const auto &edge: name_index.GetEdges()) {
+    labels.push_back(edge.label);
+    serialized_name_index.add_edge_child(edge.child);
+  }
+  serialized_name_index.set_edge_labels(std::move(labels));
+  return serialized_name_index;
+}
+
+base_file::StringRef AddString(std::string &strings, std::string_view value) {
+  const base_file::StringRef ref{strings.size(), value.size()};
+  strings += value;
+  return ref;
+}
+
+void SerializeMappedTransportCatalogue(std::ostream &out,
+                                       const transcat::TransportCatalogue &transport_catalogue,
+                                       const transcat::RenderSettings &render_settings,
+                                       const transcat::RoutingSettings &routing_settings,
+                                       const std::shared_ptr<transcat::TransportRouter>& transport_router,
+                                       const transcat::NameIndex &name_index,
+                                       const std::string &rendered_map) {
+  transport_router->Initialize(routing_settings);
+  base_file::Writer writer;
+  std::string strings;
+
+  // Остановки и маршруты записываются в порядке идентификаторов, которые им назначил справочник
+  const auto &all_stops = transport_catalogue.GetAllStops();
+  std::vector<const transcat::Stop *> stops(all_stops.size());
+  for (const auto &[name, stop]: all_stops) {
+    stops[stop->id] = stop;
+  }
+  const auto &reversed_data = transport_router->GetReversedDataForGraph();
+  std::vector<base_file::StopRecord> stop_records;
+  stop_records.reserve(stops.size());
+  for (const auto *stop: stops) {
+    const auto vertex_it = reversed_data.find(stop->name);
+    const uint32_t vertex = vertex_it == reversed_data.end() ? base_file::kNoVertex
+                                                             : static_cast<uint32_t>(vertex_it->second);
+    stop_records.push_back({AddString(strings, stop->name), stop->coords.lat, stop->coords.lng, vertex, 0});
+  }
+
+  const auto &all_buses = transport_catalogue.GetAllRoutes();
+  std::vector<const transcat::Bus *> buses(all_buses.size());
+  for (const auto &[name, bus]: all_buses) {
+    buses[bus->id] = bus;
+  }
+  std::vector<base_file::BusRecord> bus_records;
+  std::vector<uint32_t> bus_stops;
+  bus_records.reserve(buses.size());
+  for (const auto *bus: buses) {
+    bus_records.push_back({AddString(strings, bus->name),
+                           static_cast<uint32_t>(bus_stops.size()),
+                           static_cast<uint32_t>(bus->route.stops.size()),
+                           bus->route.is_roundtrip ? 1u : 0u, 0});
+    for (const auto *stop: bus->route.stops) {
+      bus_stops.push_back(static_cast<uint32_t>(stop->id));
+    }
+  }
+
+  std::vector<base_file::DistanceRecord> distances;
+  distances.reserve(transport_catalogue.GetDistanceBetweenStops().size());
+  for (const auto &[stops_pair, distance]: transport_catalogue.GetDistanceBetweenStops()) {
+    distances.push_back({static_cast<uint32_t>(stops_pair.first->id),
+                         static_cast<uint32_t>(stops_pair.second->id),
+                         distance});
+  }
+
+  // Рёбра и списки смежности записываются в том виде, в каком граф хранит их в памяти
+  const auto &graph = transport_router->GetGraph();
+  const std::vector<base_file::EdgeRecord> edges(graph.GetEdges(), graph.GetEdges() + graph.GetEdgeCount());
+  const std::vector<uint32_t> incidence_offsets(graph.GetIncidenceOffsets(),
+                                                graph.GetIncidenceOffsets() + graph.GetVertexCount() + 1);
+  const std::vector<uint32_t> incidence_edges(graph.GetIncidenceEdges(),
+                                              graph.GetIncidenceEdges() + graph.GetEdgeCount());
+
+  // Матрица маршрутов хранится целиком с фиксированной шириной ячеек, чтобы читать её на месте
+  const auto &routes_internal_data = transport_router->GetRouter()->GetRoutesInternalData();
+  std::vector<double> route_weights;
+  std::vector<int32_t> route_prev_edges;
+  route_weights.reserve(routes_internal_data.size() * routes_internal_data.size());
+  route_prev_edges.reserve(routes_internal_data.size() * routes_internal_data.size());
+  for (const auto &row: routes_internal_data) {
+    for (const auto &optional_rid: row) {
+      if (!optional_rid.has_value()) {
+        route_weights.push_back(0.0);
+        route_prev_edges.push_back(base_file::kUnreachable);
+      } else {
+        route_weights.push_back(optional_rid->weight);
+        route_prev_edges.push_back(optional_rid->prev_edge.has_value()
+                                   ? static_cast<int32_t>(*optional_rid->prev_edge)
+                                   : base_file::kNoPrevEdge);
+      }
+    }
+  }
+
+  std::vector<base_file::NameNodeRecord> name_nodes;
+  name_nodes.reserve(name_index.GetNodes().size());
+  for (const auto &node: name_index.GetNodes()) {
+    name_nodes.push_back({node.first_edge, node.edge_count, node.kinds});
+  }
+  std::vector<base_file::NameEdgeRecord> name_edges;
+  name_edges.reserve(name_index.GetEdges().size());
+  for (const auto &edge: name_index.GetEdges()) {
+    name_edges.push_back({static_cast<unsigned char>(edge.label), edge.child});
+  }
+
+  const std::string serialized_render_settings = SerializeRenderSettings(render_settings).SerializeAsString();
+  const std::string serialized_routing_settings = SerializeRoutingSettings(routing_settings).SerializeAsString();
+
+  writer.AddSection(base_file::SectionId::Strings, strings.data(), strings.size());
+  writer.AddArray(base_file::SectionId::Stops, stop_records);
+  writer.AddArray(base_file::SectionId::Buses, bus_records);
+  writer.AddArray(base_file::SectionId::BusStops, bus_stops);
+  writer.AddArray(base_file::SectionId::Distances, distances);
+  writer.AddSection(base_file::SectionId::RenderSettings,
+                    serialized_render_settings.data(), serialized_render_settings.size());
+  writer.AddSection(base_file::SectionId::RoutingSettings,
+                    serialized_routing_settings.data(), serialized_routing_settings.size());
+  writer.AddArray(base_file::SectionId::GraphEdges, edges);
+  writer.AddArray(base_file::SectionId::IncidenceOffsets, incidence_offsets);
+  writer.AddArray(base_file::SectionId::IncidenceEdges, incidence_edges);
+  writer.AddArray(base_file::SectionId::RouteWeights, route_weights);
+  writer.AddArray(base_file::SectionId::RoutePrevEdges, route_prev_edges);
+  writer.AddArray(base_file::SectionId::NameNodes, name_nodes);
+  writer.AddArray(base_file::SectionId::NameEdges, name_edges);
+  if (!rendered_map.empty()) {
+    writer.AddSection(base_file::SectionId::RenderedMap, rendered_map.data(), rendered_map.size());
+  }
+  writer.Write(out);
+}
+
 void SerializeTransportCatalogue(const std::string &file_name,
+                                 transcat::BaseFormat format,
                                  const transcat::TransportCatalogue &transport_catalogue,
                                  const transcat::RenderSettings &render_settings,
                                  const transcat::RoutingSettings &routing_settings,
-                                 const std::shared_ptr<transcat::TransportRouter>& transport_router) {
+                                 const std::shared_ptr<transcat::TransportRouter>& transport_router,
+                                 const transcat::NameIndex &name_index,
+                                 const std::string &rendered_map) {
   if (file_name.empty()) {
     return;
   }
   std::ofstream out(file_name, std::ios::binary);
+  if (format == transcat::BaseFormat::Mapped) {
+    SerializeMappedTransportCatalogue(out, transport_catalogue, render_settings, routing_settings,
+                                      transport_router, name_index, rendered_map);
+    return;
+  }
   std::unordered_map<const transcat::Stop *, int> stop_id_list;
   std::unordered_map<const std::string_view, int, BusHash, std::equal_to<>> bus_id_list;
   transport_catalogue_serialize::TransportCatalogue serialized_transport_catalogue;
@@ -264,6 +425,8 @@ void SerializeTransportCatalogue(const std::string &file_name,
   *serialized_transport_catalogue.mutable_routing_settings() = SerializeRoutingSettings(routing_settings);
   *serialized_transport_catalogue.mutable_transport_router() =
       SerializeTransportRouter(transport_catalogue, transport_router, routing_settings, stop_id_list, bus_id_list);
+  *serialized_transport_catalogue.mutable_name_index() = SerializeNameIndex(name_index);
+  serialized_transport_catalogue.set_rendered_map(rendered_map);
   serialized_transport_catalogue.SerializeToOstream(&out);
 }
 
@@ -305,6 +468,11 @@ transcat::RenderSettings DeserializeRenderSettings(const transport_catalogue_ser
   render_settings.stop_label_offset[1] = serialized_render_settings.stop_label_offset(1);
   render_settings.underlayer_color = DeserializeColor(serialized_render_settings.underlayer_color());
   render_settings.underlayer_width = serialized_render_settings.underlayer_width();
+  if (serialized_render_settings.coordinate_precision() != 0) {
+    render_settings.coordinate_precision =
+        std::min(serialized_render_settings.coordinate_precision(), number_format::FloatFormat::kMaxPrecision);
+  }
+  render_settings.simplify_tolerance = serialized_render_settings.simplify_tolerance();
   const int size = serialized_render_settings.color_palette_size();
   for (int i = 0; i < size; ++i) {
     render_settings.color_palette.push_back(DeserializeColor(serialized_render_settings.color_palette(i)));
@@ -319,62 +487,76 @@ transcat::RoutingSettings DeserializeRoutingSettings(const transport_catalogue_s
   return routing_settings;
 }
 
+// Остановки и маршруты добавлены в справочник в порядке списков сообщения, поэтому их индексы в сообщении
+// совпадают с идентификаторами в справочнике
 graph::Edge<Minutes> DeserializeEdge(const transcat::TransportCatalogue &transport_catalogue,
-                                     const transport_catalogue_serialize::Edge &serialized_edge,
-                                     const transport_catalogue_serialize::StopsList &stops_list,
-                                     const transport_catalogue_serialize::BusesList &buses_list) {
-  graph::Edge<Minutes> edge;
+                                     const transport_catalogue_serialize::Edge &serialized_edge) {
+  graph::Edge<Minutes> edge{};
   edge.from = serialized_edge.from();
   edge.to = serialized_edge.to();
   edge.weight = serialized_edge.weight();
+  edge.bus = graph::kNoBus;
   if (serialized_edge.bus_id() != 0) {
-    const auto &bus_name = buses_list.buses(serialized_edge.bus_id() - 1);
-    const auto *bus = transport_catalogue.FindBus(bus_name.name());
-    if (bus != nullptr) {
-      edge.bus_name = bus->name;
-    }
-  }
-
-  const auto &stop_name = stops_list.stops(serialized_edge.stop_id());
-  const auto *stop = transport_catalogue.FindStop(stop_name.name());
-  if (stop != nullptr) {
-    edge.stop_name = stop->name;
+    edge.bus = static_cast<uint32_t>(transport_catalogue.GetBus(serialized_edge.bus_id() - 1)->id);
   }
+  edge.stop = static_cast<uint32_t>(transport_catalogue.GetStop(serialized_edge.stop_id())->id);
   edge.span_count = serialized_edge.span_count();
   return edge;
 }
 
-void DeserializeGraph(const transcat::TransportCatalogue &transport_catalogue,
-                      graph::DirectedWeightedGraph<Minutes> &graph,
-                      const transport_catalogue_serialize::Graph &serialized_graph,
-                      const transport_catalogue_serialize::StopsList &stops_list,
-                      const transport_catalogue_serialize::BusesList &buses_list
-) {
-
+// Списки смежности собираются заново по рёбрам: их порядок совпадает с записанным
+graph::DirectedWeightedGraph<Minutes> DeserializeGraph(const transcat::TransportCatalogue &transport_catalogue,
+                                                       const transport_catalogue_serialize::Graph &serialized_graph) {
   std::vector<graph::Edge<Minutes>> edges_list;
   const int size = serialized_graph.edges_size();
+  edges_list.reserve(size);
   for (int i = 0; i < size; ++i) {
-    graph::Edge<Minutes> edge = DeserializeEdge(transport_catalogue, serialized_graph.edges(i), stops_list, buses_list);
-    edges_list.push_back(edge);
-  }
-  const int incidence_list_size = serialized_graph.incidence_lists_size();
-  std::vector<std::vector<graph::EdgeId>> incidence_lists;
-  for (int j = 0; j < incidence_list_size; ++j) {
-    std::vector<graph::EdgeId> list;
-    const auto &serialized_list = serialized_graph.incidence_lists(j);
-    const int serialized_list_size = serialized_list.edge_id_size();
-    for (int k = 0; k < serialized_list_size; ++k) {
-      list.push_back(serialized_list.edge_id(k));
+    edges_list.push_back(DeserializeEdge(transport_catalogue, serialized_graph.edges(i)));
+  }
+  return graph::DirectedWeightedGraph<Minutes>(serialized_graph.incidence_lists_size(), std::move(edges_list));
+}
+
+std::vector<std::vector<std::optional
+                            <graph::RouteInternalData<Minutes>>>>
+DeserializePackedRouteInternalData(const transport_catalogue_serialize::TransportRouter &serialised_transport_router) {
+  const size_t vertex_count = serialised_transport_router.vertex_count();
+  const auto &weights = serialised_transport_router.route_weights();
+  const auto &prev_edge_ids = serialised_transport_router.route_prev_edge_ids();
+  std::vector<std::vector<std::optional<graph::RouteInternalData<Minutes>>>> routes_internal_data(vertex_count);
+  int weight = 0;
+  int prev_edge_id = 0;
+  for (auto &row: routes_internal_data) {
+    row.resize(vertex_count);
+    size_t to = 0;
+    while (to < vertex_count) {
+      if (prev_edge_id == prev_edge_ids.size()) {
+        throw std::runtime_error("Routes internal data is truncated");
+      }
+      const int32_t value = prev_edge_ids.Get(prev_edge_id++);
+      if (value < kNoPrevEdge) {
+        to += static_cast<size_t>(kNoPrevEdge - value);
+        continue;
+      }
+      if (weight == weights.size()) {
+        throw std::runtime_error("Routes internal data is truncated");
+      }
+      row[to++] = graph::RouteInternalData<Minutes>{
+          weights.Get(weight++),
+          value == kNoPrevEdge ? std::nullopt : std::optional<graph::EdgeId>(value)};
+    }
+    if (to != vertex_count) {
+      throw std::runtime_error("Routes internal data is corrupted");
     }
-    incidence_lists.push_back(std::move(list));
   }
-  graph.SetEdges(edges_list);
-  graph.SetIncidenceLists(incidence_lists);
+  return routes_internal_data;
 }
 
 std::vector<std::vector<std::optional
                             <graph::RouteInternalData<Minutes>>>>
 DeserializeRouteInternalData(const transport_catalogue_serialize::TransportRouter &serialised_transport_router) {
+  if (serialised_transport_router.vertex_count() != 0) {
+    return DeserializePackedRouteInternalData(serialised_transport_router);
+  }
   std::vector<std::vector<std::optional<graph::RouteInternalData<Minutes>>>> routes_internal_data;
   const transport_catalogue_serialize::optionalRID empty_rid;
   const int size = serialised_transport_router.routes_internal_data_size();
@@ -407,16 +589,14 @@ DeserializeRouteInternalData(const transport_catalogue_serialize::TransportRoute
   return routes_internal_data;
 }
 
-std::unordered_map<std::string_view
-                   , size_t> DeserializeReversedDataForGraph(const transport_catalogue_serialize::TransportRouter &serialised_transport_router,
-                                                             const transport_catalogue_serialize::StopsList &stops_list,
-                                                             const transcat::TransportCatalogue &transport_catalogue) {
+std::unordered_map<std::string_view, size_t> DeserializeReversedDataForGraph(
+    const transport_catalogue_serialize::TransportRouter &serialised_transport_router,
+    const transcat::TransportCatalogue &transport_catalogue) {
   std::unordered_map<std::string_view, size_t> reversed_data_for_graph;
   const int size = serialised_transport_router.reversed_data_for_graph_size();
   for (int i = 0; i < size; ++i) {
     const auto &serialized_reversed_data = serialised_transport_router.reversed_data_for_graph(i);
-    const auto &serialized_stop = stops_list.stops(serialized_reversed_data.stop_id());
-    const auto *const stop = transport_catalogue.FindStop(serialized_stop.name());
+    const auto *const stop = transport_catalogue.GetStop(serialized_reversed_data.stop_id());
     reversed_data_for_graph.insert({stop->name, serialized_reversed_data.reversed_stop_id()});
   }
 
@@ -425,91 +605,300 @@ std::unordered_map<std::string_view
 
 void DeserializeTransportRouter(const transport_catalogue_serialize::TransportRouter &serialised_transport_router,
                                 const transcat::TransportCatalogue &transport_catalogue,
-                                const std::shared_ptr<transcat::TransportRouter>& transport_router,
-                                const transport_catalogue_serialize::StopsList &stops_list,
-                                const transport_catalogue_serialize::BusesList &buses_list
-) {
-  DeserializeGraph(transport_catalogue,
-                   transport_router->GetGraph(),
-                   serialised_transport_router.graph(),
-                   stops_list,
-                   buses_list);
+                                const std::shared_ptr<transcat::TransportRouter>& transport_router) {
+  transport_router->SetGraph(DeserializeGraph(transport_catalogue, serialised_transport_router.graph()));
   transport_router->SetReverseDataForGraph(DeserializeReversedDataForGraph(serialised_transport_router,
-                                                                           stops_list,
                                                                            transport_catalogue));
   const auto router =
       graph::Router<Minutes>(transport_router->GetGraph(), DeserializeRouteInternalData(serialised_transport_router));
   transport_router->SetRouter(router);
 }
 
+transcat::NameIndex DeserializeNameIndex(const transport_catalogue_serialize::NameIndex &serialized_name_index) {
+  std::vector<transcat::NameIndex::TrieNode> nodes;
+  const int nodes_size = serialized_name_index.first_edge_size();
+  nodes.reserve(nodes_size);
+  for (int i = 0; i < nodes_size; ++i) {
+    nodes.push_back({serialized_name_index.first_edge(i),
+                     serialized_name_index.edge_count(i),
+                     static_cast<uint8_t>(serialized_name_index.kinds(i))});
+  }
+  std::vector<transcat::NameIndex::TrieEdge> edges;
+  const auto &labels = serialized_name_index.edge_labels();
+  const int edges_size = std::min(serialized_name_index.edge_child_size(), static_cast<int>(labels.size()));
+  edges.reserve(edges_size);
+  for (int i = 0; i < edges_size; ++i) {
+    edges.push_back({labels[i], serialized_name_index.edge_child(i)});
+  }
+  transcat::NameIndex name_index;
+  name_index.SetTrie(std::move(nodes), std::move(edges));
+  return name_index;
+}
+
+// Справочник из базы base_file: записи остановок и маршрутов по их индексам в файле
+struct MappedCatalogue {
+  std::shared_ptr<const base_file::MappedFile> file;
+  std::vector<const transcat::Stop *> stops;
+  std::vector<const transcat::Bus *> buses;
+};
+
+void DeserializeMappedRouter(const MappedCatalogue &catalogue,
+                             transcat::RoutingSettings &routing_settings,
+                             transcat::TransportRouter &transport_router) {
+  const auto &file = *catalogue.file;
+  transport_catalogue_serialize::RoutingSettings serialized_routing_settings;
+  const auto routing_settings_bytes = file.GetBytes(base_file::SectionId::RoutingSettings);
+  serialized_routing_settings.ParseFromArray(routing_settings_bytes.data(),
+                                             static_cast<int>(routing_settings_bytes.size()));
+  routing_settings = DeserializeRoutingSettings(serialized_routing_settings);
+  transport_router.SetRoutingSettings(routing_settings);
+
+  size_t stops_count = 0;
+  const auto *const stop_records = file.GetArray<base_file::StopRecord>(base_file::SectionId::Stops, stops_count);
+  std::unordered_map<std::string_view, size_t> reverse_data_for_graph;
+  for (size_t i = 0; i < stops_count; ++i) {
+    if (stop_records[i].vertex != base_file::kNoVertex) {
+      reverse_data_for_graph.insert({catalogue.stops.at(i)->name, stop_records[i].vertex});
+    }
+  }
+  transport_router.SetReverseDataForGraph(reverse_data_for_graph);
+
+  // Граф читает рёбра и списки смежности из отображения на месте. Файл не разбирается,
+  // поэтому индексы в нём проверяются один раз здесь, а не при каждом обращении
+  size_t edges_count = 0;
+  const auto *const edges = file.GetArray<base_file::EdgeRecord>(base_file::SectionId::GraphEdges, edges_count);
+  size_t offsets_count = 0;
+  const auto *const offsets = file.GetArray<uint32_t>(base_file::SectionId::IncidenceOffsets, offsets_count);
+  size_t incidence_edges_count = 0;
+  const auto *const incidence_edges =
+      file.GetArray<uint32_t>(base_file::SectionId::IncidenceEdges, incidence_edges_count);
+  const size_t vertex_count = offsets_count == 0 ? 0 : offsets_count - 1;
+  if (offsets_count == 0 || offsets[0] != 0 || offsets[vertex_count] != incidence_edges_count) {
+    throw std::runtime_error("Incidence lists are out of the incidence edges section");
+  }
+  for (size_t v = 0; v < vertex_count; ++v) {
+    if (offsets[v] > offsets[v + 1]) {
+      throw std::runtime_error("Incidence lists are out of the incidence edges section");
+    }
+  }
+  for (size_t i = 0; i < incidence_edges_count; ++i) {
+    if (incidence_edges[i] >= edges_count) {
+      throw std::runtime_error("Incidence list refers to a missing edge");
+    }
+  }
+  for (size_t i = 0; i < edges_count; ++i) {
+    const auto &edge = edges[i];
+    if (edge.from >= vertex_count || edge.to >= vertex_count || edge.stop >= catalogue.stops.size()
+        || (edge.bus != graph::kNoBus && edge.bus >= catalogue.buses.size())) {
+      throw std::runtime_error("Graph edge is out of the base sections");
+    }
+  }
+  transport_router.SetGraph(graph::DirectedWeightedGraph<Minutes>(vertex_count, edges, edges_count,
+                                                                  offsets, incidence_edges, catalogue.file));
+  const auto &graph = transport_router.GetGraph();
+
+  // Матрица маршрутов не копируется: маршрутизатор читает её из отображения и продлевает его жизнь
+  size_t weights_count = 0;
+  const auto *const weights = file.GetArray<double>(base_file::SectionId::RouteWeights, weights_count);
+  size_t prev_edges_count = 0;
+  const auto *const prev_edges = file.GetArray<int32_t>(base_file::SectionId::RoutePrevEdges, prev_edges_count);
+  if (weights_count != vertex_count * vertex_count || prev_edges_count != vertex_count * vertex_count) {
+    throw std::runtime_error("Routes matrix size mismatch");
+  }
+  transport_router.SetRouter(graph::Router<Minutes>(
+      graph, graph::RoutesMatrixView<Minutes>{vertex_count, weights, prev_edges, catalogue.file}));
+}
+
+transcat::NameIndex DeserializeMappedNameIndex(const base_file::MappedFile &file,
+                                               const transcat::TransportCatalogue &transport_catalogue) {
+  if (!file.HasSection(base_file::SectionId::NameNodes)) {
+    return transcat::NameIndex(transport_catalogue);
+  }
+  size_t nodes_count = 0;
+  const auto *const node_records = file.GetArray<base_file::NameNodeRecord>(base_file::SectionId::NameNodes, nodes_count);
+  std::vector<transcat::NameIndex::TrieNode> nodes;
+  nodes.reserve(nodes_count);
+  for (size_t i = 0; i < nodes_count; ++i) {
+    nodes.push_back({node_records[i].first_edge, node_records[i].edge_count,
+                     static_cast<uint8_t>(node_records[i].kinds)});
+  }
+  size_t edges_count = 0;
+  const auto *const edge_records = file.GetArray<base_file::NameEdgeRecord>(base_file::SectionId::NameEdges, edges_count);
+  std::vector<transcat::NameIndex::TrieEdge> edges;
+  edges.reserve(edges_count);
+  for (size_t i = 0; i < edges_count; ++i) {
+    edges.push_back({static_cast<char>(edge_records[i].label), edge_records[i].child});
+  }
+  transcat::NameIndex name_index;
+  name_index.SetTrie(std::move(nodes), std::move(edges));
+  return name_index;
+}
+
+/*
+ * Сразу загружается только справочник, он нужен запросам всех типов.
+ * Маршрутизатор, индекс названий и карта читаются из своих разделов при первом запросе,
+ * которому они нужны, поэтому пакеты только из запросов Bus и Stop их не загружают
+ */
+void DeserializeMappedTransportCatalogue(const std::string &file_name,
+                                         transcat::RenderSettings &render_settings,
+                                         transcat::RoutingSettings &routing_settings,
+                                         transcat::queries::QueryManager *queryManager,
+                                         transcat::TransportCatalogue &transport_catalogue) {
+  auto catalogue = std::make_shared<MappedCatalogue>();
+  catalogue->file = std::make_shared<const base_file::MappedFile>(file_name);
+  const auto &file = *catalogue->file;
+
+  // Справочник заполняется напрямую по индексам записей, без поиска остановок по названиям.
+  // Названия не копируются: они указывают в раздел Strings, и справочник продлевает жизнь отображению
+  transport_catalogue.KeepAlive(catalogue->file);
+  size_t stops_count = 0;
+  const auto *const stop_records = file.GetArray<base_file::StopRecord>(base_file::SectionId::Stops, stops_count);
+  catalogue->stops.reserve(stops_count);
+  for (size_t i = 0; i < stops_count; ++i) {
+    transcat::Stop stop;
+    stop.name = file.GetString(stop_records[i].name);
+    stop.coords = {stop_records[i].lat, stop_records[i].lng};
+    catalogue->stops.push_back(transport_catalogue.AddNewStop(stop));
+  }
+  const auto &stops = catalogue->stops;
+
+  size_t distances_count = 0;
+  const auto *const distances =
+      file.GetArray<base_file::DistanceRecord>(base_file::SectionId::Distances, distances_count);
+  for (size_t i = 0; i < distances_count; ++i) {
+    transport_catalogue.InsertStopsDistance(stops.at(distances[i].from), stops.at(distances[i].to),
+                                            distances[i].distance);
+  }
+
+  size_t buses_count = 0;
+  const auto *const bus_records = file.GetArray<base_file::BusRecord>(base_file::SectionId::Buses, buses_count);
+  size_t bus_stops_count = 0;
+  const auto *const bus_stops = file.GetArray<uint32_t>(base_file::SectionId::BusStops, bus_stops_count);
+  catalogue->buses.reserve(buses_count);
+  for (size_t i = 0; i < buses_count; ++i) {
+    const auto &record = bus_records[i];
+    if (record.first_stop > bus_stops_count || record.stop_count > bus_stops_count - record.first_stop) {
+      throw std::runtime_error("Bus stops are out of the bus stops section");
+    }
+    transcat::Bus bus;
+    bus.name = file.GetString(record.name);
+    bus.route.is_roundtrip = record.is_roundtrip != 0;
+    bus.route.stops.reserve(record.stop_count);
+    for (uint32_t j = 0; j < record.stop_count; ++j) {
+      bus.route.stops.push_back(stops.at(bus_stops[record.first_stop + j]));
+    }
+    const auto *const new_bus = transport_catalogue.AddNewBus(bus);
+    transport_catalogue.AddPassingBus(new_bus);
+    catalogue->buses.push_back(new_bus);
+  }
+
+  // Настройки принадлежат queryManager и живут дольше его загрузчиков
+  const auto tr = std::make_shared<transcat::TransportRouter>(transport_catalogue);
+  queryManager->SetTransportRouter(tr);
+  using LazyPart = transcat::queries::QueryManager::LazyPart;
+  queryManager->SetLazyLoader(LazyPart::Router, [catalogue, tr, &routing_settings] {
+    DeserializeMappedRouter(*catalogue, routing_settings, *tr);
+  });
+  queryManager->SetLazyLoader(LazyPart::NameIndex, [catalogue, queryManager, &transport_catalogue] {
+    queryManager->SetNameIndex(DeserializeMappedNameIndex(*catalogue->file, transport_catalogue));
+  });
+  queryManager->SetLazyLoader(LazyPart::Map, [catalogue, queryManager, &render_settings] {
+    const auto &file = *catalogue->file;
+    transport_catalogue_serialize::Render_settings serialized_render_settings;
+    const auto render_settings_bytes = file.GetBytes(base_file::SectionId::RenderSettings);
+    serialized_render_settings.ParseFromArray(render_settings_bytes.data(),
+                                              static_cast<int>(render_settings_bytes.size()));
+    render_settings = DeserializeRenderSettings(serialized_render_settings);
+    const auto rendered_map = file.GetBytes(base_file::SectionId::RenderedMap);
+    if (!rendered_map.empty()) {
+      queryManager->SetRenderedMap(rendered_map);
+    }
+  });
+}
+
 void DeserializeTransportCatalogue(const std::string &file_name,
-                                   std::vector<InfoQuery> &queries_to_add,
                                    transcat::RenderSettings &render_settings,
                                    transcat::RoutingSettings &routing_settings,
                                    transcat::queries::QueryManager *queryManager,
-                                   const transcat::TransportCatalogue &tc
+                                   transcat::TransportCatalogue &tc
 ) {
   if (file_name.empty()) {
     return;
   }
+  if (base_file::IsMappedBase(file_name)) {
+    DeserializeMappedTransportCatalogue(file_name, render_settings, routing_settings, queryManager, tc);
+    return;
+  }
   std::ifstream file(file_name, std::ios::binary);
-  transport_catalogue_serialize::TransportCatalogue transport_catalogue;
+  // Сообщение разбирается целиком, но загрузчики маршрутизатора, индекса названий и карты
+  // строят их из него только при первом запросе, которому они нужны
+  const auto serialized = std::make_shared<transport_catalogue_serialize::TransportCatalogue>();
+  const auto &transport_catalogue = *serialized;
   if (file) {
     std::stringstream buffer;
     buffer << file.rdbuf();
     file.close();
 
-    if (transport_catalogue.ParseFromIstream(&buffer)) {
+    if (serialized->ParseFromIstream(&buffer)) {
+      // Справочник заполняется по индексам остановок в сообщении, без поиска по названиям, как для base_file.
+      // Названия указывают в строки сообщения, поэтому справочник продлевает ему жизнь
+      tc.KeepAlive(serialized);
       const auto &stops_list = transport_catalogue.stops_list();
       const int stop_size = stops_list.stops_size();
-      std::unordered_map<std::string_view, size_t> reverse_data_for_graph;
+      std::vector<const transcat::Stop *> stops;
+      stops.reserve(stop_size);
       for (int i = 0; i < stop_size; ++i) {
-        const transport_catalogue_serialize::Stop &stop = stops_list.stops(i);
-        StopQuery stop_query;
-        stop_query.name = stop.name();
-        stop_query.coordinates = {stop.coordinates_lat(), stop.coordinates_lng()};
-        reverse_data_for_graph.insert({stop_query.name, i});
-        queries_to_add.push_back(std::move(stop_query));
+        const transport_catalogue_serialize::Stop &serialized_stop = stops_list.stops(i);
+        transcat::Stop stop;
+        stop.name = serialized_stop.name();
+        stop.coords = {serialized_stop.coordinates_lat(), serialized_stop.coordinates_lng()};
+        stops.push_back(tc.AddNewStop(stop));
       }
       const auto &distances_list = transport_catalogue.distances_list();
       const int distances_size = distances_list.distance_size();
       for (int i = 0; i < distances_size; ++i) {
         const transport_catalogue_serialize::DistanceBetweenStops &distance = distances_list.distance(i);
-        RoadDistanceQuery road_distance_query;
-        road_distance_query.name = stops_list.stops(distance.first_stop_id()).name();
-        const auto &second_stop = stops_list.stops(distance.second_stop_id()).name();
-        road_distance_query.road_distances.push_back({second_stop, distance.distance()});
-        queries_to_add.push_back(std::move(road_distance_query));
+        tc.InsertStopsDistance(stops.at(distance.first_stop_id()), stops.at(distance.second_stop_id()),
+                               distance.distance());
       }
       const auto &buses_list = transport_catalogue.buses_list();
       const int buses_size = buses_list.buses_size();
       for (int i = 0; i < buses_size; ++i) {
-        const transport_catalogue_serialize::Bus &bus = buses_list.buses(i);
-        BusQuery bus_query;
-        bus_query.name = bus.name();
-        bus_query.is_roundtrip = bus.is_roundtrip();
-        const int stops_size = bus.stops_id_size();
+        const transport_catalogue_serialize::Bus &serialized_bus = buses_list.buses(i);
+        transcat::Bus bus;
+        bus.name = serialized_bus.name();
+        bus.route.is_roundtrip = serialized_bus.is_roundtrip();
+        const int stops_size = serialized_bus.stops_id_size();
+        bus.route.stops.reserve(stops_size);
         for (int j = 0; j < stops_size; ++j) {
-          bus_query.route.push_back(stops_list.stops(bus.stops_id(j)).name());
+          bus.route.stops.push_back(stops.at(serialized_bus.stops_id(j)));
         }
-        queries_to_add.push_back(std::move(bus_query));
+        tc.AddPassingBus(tc.AddNewBus(bus));
       }
 
-      render_settings = DeserializeRenderSettings(transport_catalogue.render_settings());
-      routing_settings = DeserializeRoutingSettings(transport_catalogue.routing_settings());
-
-      queryManager->AddQueriesToTC();
-      transcat::TransportRouter transport_router(tc);
-      const auto tr = std::make_shared<transcat::TransportRouter>(transport_router);
-      tr->SetRoutingSettings(routing_settings);
+      const auto tr = std::make_shared<transcat::TransportRouter>(tc);
       queryManager->SetTransportRouter(tr);
 
-      DeserializeTransportRouter(transport_catalogue.transport_router(),
-                                 tc,
-                                 queryManager->GetTranstoptRouter(),
-                                 stops_list,
-                                 buses_list);
-
+      // Настройки принадлежат queryManager и живут дольше его загрузчиков
+      using LazyPart = transcat::queries::QueryManager::LazyPart;
+      queryManager->SetLazyLoader(LazyPart::Router, [serialized, tr, &routing_settings, &tc] {
+        routing_settings = DeserializeRoutingSettings(serialized->routing_settings());
+        tr->SetRoutingSettings(routing_settings);
+        DeserializeTransportRouter(serialized->transport_router(), tc, tr);
+      });
+      queryManager->SetLazyLoader(LazyPart::NameIndex, [serialized, queryManager, &tc] {
+        if (serialized->has_name_index()) {
+          queryManager->SetNameIndex(DeserializeNameIndex(serialized->name_index()));
+        } else {
+          queryManager->SetNameIndex(transcat::NameIndex(tc));
+        }
+      });
+      queryManager->SetLazyLoader(LazyPart::Map, [serialized, queryManager, &render_settings] {
+        render_settings = DeserializeRenderSettings(serialized->render_settings());
+        if (!serialized->rendered_map().empty()) {
+          queryManager->SetRenderedMap(serialized->rendered_map());
+        }
+      });
     }
   }
 
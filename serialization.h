@@ -5,19 +5,23 @@
 
 #include "json_reader.h"
 #include "map_renderer.h"
+#include "name_index.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
 using namespace transcat;
 
+// Формат записи задаёт format, при чтении он определяется по сигнатуре файла
 void SerializeTransportCatalogue(const std::string &file_name,
+                                 transcat::BaseFormat format,
                                  const transcat::TransportCatalogue &transport_catalogue,
                                  const transcat::RenderSettings &render_settings,
                                  const transcat::RoutingSettings &routing_settings,
-                                 const std::shared_ptr<transcat::TransportRouter>& transport_router);
+                                 const std::shared_ptr<transcat::TransportRouter>& transport_router,
+                                 const transcat::NameIndex &name_index,
+                                 const std::string &rendered_map);
 void DeserializeTransportCatalogue(const std::string &file_name,
-                                   std::vector<InfoQuery> &queries_to_add,
                                    transcat::RenderSettings &render_settings,
                                    transcat::RoutingSettings &routing_settings,
                                    transcat::queries::QueryManager *queryManager,
-                                   const transcat::TransportCatalogue &transport_catalogue);
+                                   transcat::TransportCatalogue &transport_catalogue);
@@ -0,0 +1,167 @@
+#include "serve.h"
+#include "json_writer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace transcat
+  {
+    namespace serve
+      {
+        namespace
+          {
+            using namespace std::literals;
+
+            // Буфер потока поверх файлового дескриптора сокета
+            class FdStreambuf
+                : public std::streambuf {
+             public:
+              explicit FdStreambuf(int fd)
+                  : fd_(fd) {
+                setg(input_, input_, input_);
+                setp(output_, output_ + sizeof(output_));
+              }
+
+              ~FdStreambuf() override {
+                sync();
+              }
+
+             protected:
+              int_type underflow() override {
+                ssize_t count;
+                do {
+                  count = ::read(fd_, input_, sizeof(input_));
+                } while (count < 0 && errno == EINTR);
+                if (count <= 0) {
+                  return traits_type::eof();
+                }
+                setg(input_, input_, input_ + count);
+                return traits_type::to_int_type(*gptr());
+              }
+
+              int_type overflow(int_type ch) override {
+                if (sync() != 0) {
+                  return traits_type::eof();
+                }
+                if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                  *pptr() = traits_type::to_char_type(ch);
+                  pbump(1);
+                }
+                return traits_type::not_eof(ch);
+              }
+
+              int sync() override {
+                const char *data = pbase();
+                while (data != pptr()) {
+                  // MSG_NOSIGNAL: отключившийся клиент не должен завершать сервер сигналом SIGPIPE
+                  const ssize_t count = ::send(fd_, data, pptr() - data, MSG_NOSIGNAL);
+                  if (count < 0) {
+                    if (errno == EINTR) {
+                      continue;
+                    }
+                    return -1;
+                  }
+                  data += count;
+                }
+                setp(output_, output_ + sizeof(output_));
+                return 0;
+              }
+
+             private:
+              int fd_;
+              char input_[1 << 16];
+              char output_[1 << 16];
+            };
+
+            class FileDescriptor {
+             public:
+              explicit FileDescriptor(int fd)
+                  : fd_(fd) {
+                if (fd_ < 0) {
+                  throw std::system_error(errno, std::generic_category());
+                }
+              }
+              FileDescriptor(const FileDescriptor &) = delete;
+              FileDescriptor &operator=(const FileDescriptor &) = delete;
+              ~FileDescriptor() {
+                ::close(fd_);
+              }
+
+              int Get() const {
+                return fd_;
+              }
+
+             private:
+              int fd_;
+            };
+          }
+
+        void ServeStream(queries::QueryManager &qm, std::istream &input, std::ostream &output) {
+          std::string line;
+          while (std::getline(input, line)) {
+            if (line.find_first_not_of(" \t\r"sv) == std::string::npos) {
+              continue;
+            }
+            try {
+              qm.AnswerLine(line, output);
+            } catch (const std::exception &e) {
+              {
+                json::Writer writer(output, json::PrintFormat::Compact);
+                writer.StartDict().Key("error_message"sv).Value(std::string_view(e.what())).EndDict();
+              }
+              output << '\n' << std::flush;
+            }
+          }
+        }
+
+        void ServeUnixSocket(queries::QueryManager &qm, const std::string &socket_path) {
+          sockaddr_un address{};
+          address.sun_family = AF_UNIX;
+          if (socket_path.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Socket path is too long: "s + socket_path);
+          }
+          std::memcpy(address.sun_path, socket_path.data(), socket_path.size());
+
+          // Удаляется только сокет, оставшийся от прошлого запуска, а не файл, указанный по ошибке
+          struct stat path_stat{};
+          if (::lstat(socket_path.c_str(), &path_stat) == 0) {
+            if (!S_ISSOCK(path_stat.st_mode)) {
+              throw std::invalid_argument("Path exists and is not a socket: "s + socket_path);
+            }
+            if (::unlink(socket_path.c_str()) != 0) {
+              throw std::system_error(errno, std::generic_category(), socket_path);
+            }
+          } else if (errno != ENOENT) {
+            throw std::system_error(errno, std::generic_category(), socket_path);
+          }
+
+          const FileDescriptor listener(::socket(AF_UNIX, SOCK_STREAM, 0));
+          if (::bind(listener.Get(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0
+              || ::listen(listener.Get(), SOMAXCONN) != 0) {
+            throw std::system_error(errno, std::generic_category(), socket_path);
+          }
+
+          while (true) {
+            const int fd = ::accept(listener.Get(), nullptr, nullptr);
+            if (fd < 0) {
+              if (errno == EINTR) {
+                continue;
+              }
+              throw std::system_error(errno, std::generic_category(), "accept");
+            }
+            const FileDescriptor connection(fd);
+            FdStreambuf streambuf(connection.Get());
+            std::iostream stream(&streambuf);
+            ServeStream(qm, stream, stream);
+          }
+        }
+      }
+  }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "json_reader.h"
+
+#include <iostream>
+#include <string>
+
+namespace transcat
+  {
+    namespace serve
+      {
+        /*
+         * Обслуживает запросы в формате JSON Lines: каждая непустая строка — пакет
+         * {"stat_requests": [...]}, одиночный запрос либо команда {"command": "stats"},
+         * ответ на неё — одна строка.
+         * Ошибка в строке не прерывает работу, в ответ выводится {"error_message": ...}
+         */
+        void ServeStream(queries::QueryManager &qm, std::istream &input, std::ostream &output);
+
+        // Принимает соединения на локальном Unix-сокете и обслуживает их по очереди через ServeStream
+        void ServeUnixSocket(queries::QueryManager &qm, const std::string &socket_path);
+      }
+  }
@@ -1,60 +1,46 @@
 #include "svg.h"
 
+#include <charconv>
+#include <utility>
+
 namespace svg
   {
     using namespace std::literals;
 
-    std::ostream &operator<<(std::ostream &out, StrokeLineCap stroke_line_cap) {
+    std::string_view ToString(StrokeLineCap stroke_line_cap) {
       switch (stroke_line_cap) {
-        case StrokeLineCap::BUTT: {
-          out << "butt";
-          break;
-        }
-        case StrokeLineCap::ROUND: {
-          out << "round";
-          break;
-        }
-        case StrokeLineCap::SQUARE: {
-          out << "square";
-          break;
-        }
+        case StrokeLineCap::BUTT:
+          return "butt"sv;
+        case StrokeLineCap::ROUND:
+          return "round"sv;
+        case StrokeLineCap::SQUARE:
+          return "square"sv;
       }
-      return out;
+      return {};
     }
-    std::ostream &operator<<(std::ostream &out, StrokeLineJoin stroke_line_join) {
+    std::string_view ToString(StrokeLineJoin stroke_line_join) {
       switch (stroke_line_join) {
-        case StrokeLineJoin::ARCS: {
-          out << "arcs";
-          break;
-        }
-        case StrokeLineJoin::BEVEL: {
-          out << "bevel";
-          break;
-        }
-        case StrokeLineJoin::MITER: {
-          out << "miter";
-          break;
-        }
-        case StrokeLineJoin::MITER_CLIP: {
-          out << "miter-clip";
-          break;
-        }
-        case StrokeLineJoin::ROUND: {
-          out << "round";
-          break;
-        }
+        case StrokeLineJoin::ARCS:
+          return "arcs"sv;
+        case StrokeLineJoin::BEVEL:
+          return "bevel"sv;
+        case StrokeLineJoin::MITER:
+          return "miter"sv;
+        case StrokeLineJoin::MITER_CLIP:
+          return "miter-clip"sv;
+        case StrokeLineJoin::ROUND:
+          return "round"sv;
       }
-      return out;
+      return {};
     }
 
-    void Object::Render(const RenderContext &context) const {
-      context.RenderIndent();
-
-      // Делегируем вывод тега своим подклассам
-      RenderObject(context);
-
-      context.out << std::endl;
+    std::ostream &operator<<(std::ostream &out, StrokeLineCap stroke_line_cap) {
+      return out << ToString(stroke_line_cap);
     }
+    std::ostream &operator<<(std::ostream &out, StrokeLineJoin stroke_line_join) {
+      return out << ToString(stroke_line_join);
+    }
+
 // ---------- Circle ------------------
 
     Circle &Circle::SetCenter(Point center) {
@@ -69,8 +55,13 @@ namespace svg
 
     void Circle::RenderObject(const RenderContext &context) const {
       auto &out = context.out;
-      out << " <circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-      out << "r=\""sv << radius_ << "\""sv;
+      out << " <circle cx=\""sv;
+      context.RenderCoordinate(center_.x);
+      out << "\" cy=\""sv;
+      context.RenderCoordinate(center_.y);
+      out << "\" r=\""sv;
+      context.RenderCoordinate(radius_);
+      out << "\""sv;
       RenderAttrs(out);
       out << "/>"sv;
     }
@@ -90,9 +81,11 @@ namespace svg
         if (first_point) {
           first_point = false;
         } else {
-          out << " ";
+          out.put(' ');
         }
-        out << p.x << "," << p.y;
+        context.RenderCoordinate(p.x);
+        out.put(',');
+        context.RenderCoordinate(p.y);
       }
       out << "\""sv;
       RenderAttrs(out);
@@ -136,8 +129,15 @@ namespace svg
 
       out << " <text";
       RenderAttrs(out);
-      out << " x=\""sv << position_.x << "\" y=\""sv << position_.y << "\""sv;
-      out << " dx=\""sv << offset_.x << "\" "sv << "dy=\""sv << offset_.y << "\""sv;
+      out << " x=\""sv;
+      context.RenderCoordinate(position_.x);
+      out << "\" y=\""sv;
+      context.RenderCoordinate(position_.y);
+      out << "\" dx=\""sv;
+      context.RenderCoordinate(offset_.x);
+      out << "\" dy=\""sv;
+      context.RenderCoordinate(offset_.y);
+      out << "\""sv;
       out << " font-size=\""sv << font_size_ << "\""sv;
       if (!font_family_.empty()) {
         out << " font-family=\""sv << font_family_ << "\""sv;
@@ -149,7 +149,7 @@ namespace svg
       EscapeTextData(context, data_);
       out << "</text>"sv;
     }
-    void Text::EscapeTextData(const RenderContext &context, const std::string &data) const {
+    void Text::EscapeTextData(const RenderContext &context, std::string_view data) const {
       auto &out = context.out;
       for (const auto &c : data) {
         switch (c) {
@@ -176,16 +176,250 @@ namespace svg
     }
 // ------------ Document --------------------
 
-    void Document::AddPtr(std::unique_ptr<Object> &&ptr) {
-      objects_.push_back(std::move(ptr));
+    Document::Document()
+        : pool_(std::make_unique<std::pmr::monotonic_buffer_resource>()) {
+    }
+
+    Document::Document(Document &&other) noexcept
+        : pool_(std::move(other.pool_))
+        , chunks_(std::exchange(other.chunks_, {}))
+        , size_(std::exchange(other.size_, 0))
+        , needs_destruction_(std::exchange(other.needs_destruction_, false))
+        , coordinate_format_(other.coordinate_format_) {
+    }
+
+    Document &Document::operator=(Document &&other) noexcept {
+      if (this != &other) {
+        Clear();
+        pool_ = std::move(other.pool_);
+        chunks_ = std::exchange(other.chunks_, {});
+        size_ = std::exchange(other.size_, 0);
+        needs_destruction_ = std::exchange(other.needs_destruction_, false);
+        coordinate_format_ = other.coordinate_format_;
+      }
+      return *this;
+    }
+
+    Document::~Document() {
+      Clear();
+    }
+
+    void Document::Clear() {
+      // Память элементов принадлежит пулу, деструкторы нужны, только если цвета заняли память вне его
+      if (needs_destruction_) {
+        for (size_t i = 0; i < size_; ++i) {
+          chunks_[i / kChunkSize][i % kChunkSize].~Element();
+        }
+      }
+      chunks_.clear();
+      size_ = 0;
+      needs_destruction_ = false;
+      pool_.reset();
+    }
+
+    Document::Element *Document::AllocateSlot() {
+      if (pool_ == nullptr) {
+        pool_ = std::make_unique<std::pmr::monotonic_buffer_resource>();
+      }
+      if (size_ == chunks_.size() * kChunkSize) {
+        chunks_.push_back(static_cast<Element *>(pool_->allocate(sizeof(Element) * kChunkSize, alignof(Element))));
+      }
+      return &chunks_[size_ / kChunkSize][size_ % kChunkSize];
+    }
+
+    void Document::Add(Circle circle) {
+      Emplace(circle);
+    }
+
+    void Document::Add(Polyline polyline) {
+      Emplace(polyline);
+    }
+
+    void Document::Add(Text text) {
+      Emplace(text);
     }
 
     void Document::Render(std::ostream &out) const {
-      out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
-      out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
-      for (const auto &obj : objects_) {
-        obj->Render(out);
+      out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+      out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+      const RenderContext context(out, 0, 0, coordinate_format_);
+      // Тип элемента выбирает std::visit, виртуальных вызовов нет
+      for (size_t i = 0; i < size_; ++i) {
+        std::visit([&context](const auto &obj) {
+          context.RenderIndent();
+          obj.RenderObject(context);
+          context.out.put('\n');
+        }, chunks_[i / kChunkSize][i % kChunkSize]);
       }
       out << "</svg>"sv;
     }
+  
+// ------------ Emitter --------------------
+
+    namespace
+      {
+        struct StringColorPrinter {
+          std::string &out;
+          void operator()(std::monostate) const {
+            out += "none"sv;
+          }
+          void operator()(const std::string &s) const {
+            out += s;
+          }
+          void operator()(const Rgb &rgb) const {
+            out += "rgb("sv;
+            AppendChannels(rgb);
+            out.push_back(')');
+          }
+          void operator()(const Rgba &rgba) const {
+            out += "rgba("sv;
+            AppendChannels(rgba);
+            out.push_back(',');
+            number_format::Append(out, rgba.opacity);
+            out.push_back(')');
+          }
+          void AppendChannels(const Rgb &rgb) const {
+            number_format::Append(out, static_cast<int>(rgb.red));
+            out.push_back(',');
+            number_format::Append(out, static_cast<int>(rgb.green));
+            out.push_back(',');
+            number_format::Append(out, static_cast<int>(rgb.blue));
+          }
+        };
+      }
+
+    void Emitter::StartDocument() {
+      out_ += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+      out_ += "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+    }
+
+    void Emitter::EndDocument() {
+      out_ += "</svg>"sv;
+    }
+
+    void Emitter::AddCircle(Point center, double radius, const PathStyle &style) {
+      out_ += " <circle cx=\""sv;
+      AppendCoordinate(center.x);
+      out_ += "\" cy=\""sv;
+      AppendCoordinate(center.y);
+      out_ += "\" r=\""sv;
+      AppendCoordinate(radius);
+      out_.push_back('"');
+      AppendAttrs(style);
+      out_ += "/>\n"sv;
+    }
+
+    void Emitter::StartPolyline() {
+      out_ += " <polyline points=\""sv;
+      first_point_ = true;
+    }
+
+    void Emitter::AddPoint(Point point) {
+      if (first_point_) {
+        first_point_ = false;
+      } else {
+        out_.push_back(' ');
+      }
+      AppendCoordinate(point.x);
+      out_.push_back(',');
+      AppendCoordinate(point.y);
+    }
+
+    void Emitter::EndPolyline(const PathStyle &style) {
+      out_.push_back('"');
+      AppendAttrs(style);
+      out_ += "/>\n"sv;
+    }
+
+    void Emitter::AddText(Point position, const TextStyle &text_style, const PathStyle &style,
+                          std::string_view data) {
+      out_ += " <text"sv;
+      AppendAttrs(style);
+      out_ += " x=\""sv;
+      AppendCoordinate(position.x);
+      out_ += "\" y=\""sv;
+      AppendCoordinate(position.y);
+      out_ += "\" dx=\""sv;
+      AppendCoordinate(text_style.offset.x);
+      out_ += "\" dy=\""sv;
+      AppendCoordinate(text_style.offset.y);
+      out_ += "\" font-size=\""sv;
+      char chars[number_format::kMaxChars];
+      out_.append(chars, std::to_chars(chars, chars + sizeof(chars), text_style.font_size).ptr);
+      out_.push_back('"');
+      if (!text_style.font_family.empty()) {
+        out_ += " font-family=\""sv;
+        out_ += text_style.font_family;
+        out_.push_back('"');
+      }
+      if (!text_style.font_weight.empty()) {
+        out_ += " font-weight=\""sv;
+        out_ += text_style.font_weight;
+        out_.push_back('"');
+      }
+      out_.push_back('>');
+      AppendEscapedText(data);
+      out_ += "</text>\n"sv;
+    }
+
+    void Emitter::AppendCoordinate(double value) {
+      number_format::Append(out_, value, coordinate_format_);
+    }
+
+    void Emitter::AppendAttrs(const PathStyle &style) {
+      if (style.fill_color != nullptr) {
+        out_ += " fill=\""sv;
+        AppendColor(*style.fill_color);
+        out_.push_back('"');
+      }
+      if (style.stroke_color != nullptr) {
+        out_ += " stroke=\""sv;
+        AppendColor(*style.stroke_color);
+        out_.push_back('"');
+      }
+      if (style.stroke_width.has_value()) {
+        out_ += " stroke-width=\""sv;
+        number_format::Append(out_, *style.stroke_width);
+        out_.push_back('"');
+      }
+      if (style.stroke_line_cap.has_value()) {
+        out_ += " stroke-linecap=\""sv;
+        out_ += ToString(*style.stroke_line_cap);
+        out_.push_back('"');
+      }
+      if (style.stroke_line_join.has_value()) {
+        out_ += " stroke-linejoin=\""sv;
+        out_ += ToString(*style.stroke_line_join);
+        out_.push_back('"');
+      }
+    }
+
+    void Emitter::AppendColor(const Color &color) {
+      std::visit(StringColorPrinter{out_}, color);
+    }
+
+    void Emitter::AppendEscapedText(std::string_view data) {
+      for (const char c : data) {
+        switch (c) {
+          case '\"':
+            out_ += "&quot;"sv;
+            break;
+          case '\'':
+            out_ += "&apos;"sv;
+            break;
+          case '<':
+            out_ += "&lt;"sv;
+            break;
+          case '>':
+            out_ += "&gt;"sv;
+            break;
+          case '&':
+            out_ += "&amp;"sv;
+            break;
+          default:
+            out_.push_back(c);
+            break;
+        }
+      }
+    }
   }  // namespace svg
\ No newline at end of file
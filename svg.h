@@ -3,12 +3,17 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include "number_format.h"
+
 namespace svg {
 
 struct Rgb {
@@ -54,7 +59,9 @@ struct OstreamColorPrinter {
     out << "rgb("sv << unsigned(rgb.red) << ","sv << unsigned(rgb.green) << ","sv << unsigned(rgb.blue) << ")"sv;
   }
   void operator()(const Rgba &rgba) const {
-    out << "rgba("sv << unsigned(rgba.red) << ","sv << unsigned(rgba.green) << ","sv << unsigned(rgba.blue) << ","sv << rgba.opacity << ")"sv;
+    out << "rgba("sv << unsigned(rgba.red) << ","sv << unsigned(rgba.green) << ","sv << unsigned(rgba.blue) << ","sv;
+    number_format::Write(out, rgba.opacity);
+    out << ")"sv;
   }
 };
 
@@ -72,6 +79,8 @@ enum class StrokeLineJoin {
   ROUND,
 };
 
+std::string_view ToString(StrokeLineCap stroke_line_cap);
+std::string_view ToString(StrokeLineJoin stroke_line_join);
 std::ostream &operator<<(std::ostream &out, StrokeLineCap stroke_line_cap);
 std::ostream &operator<<(std::ostream &out, StrokeLineJoin stroke_line_join);
 
@@ -87,21 +96,24 @@ struct Point {
 
 /*
  * Вспомогательная структура, хранящая контекст для вывода SVG-документа с отступами.
- * Хранит ссылку на поток вывода, текущее значение и шаг отступа при выводе элемента
+ * Хранит ссылку на поток вывода, текущее значение и шаг отступа при выводе элемента,
+ * а также профиль вывода координат
  */
 struct RenderContext {
   RenderContext(std::ostream &out)
       : out(out) {
   }
 
-  RenderContext(std::ostream &out, int indent_step, int indent = 0)
+  RenderContext(std::ostream &out, int indent_step, int indent = 0,
+                number_format::FloatFormat coordinate_format = {})
       : out(out)
       , indent_step(indent_step)
-      , indent(indent) {
+      , indent(indent)
+      , coordinate_format(coordinate_format) {
   }
 
   RenderContext Indented() const {
-    return {out, indent_step, indent + indent_step};
+    return {out, indent_step, indent + indent_step, coordinate_format};
   }
 
   void RenderIndent() const {
@@ -110,24 +122,17 @@ struct RenderContext {
     }
   }
 
+  void RenderCoordinate(double value) const {
+    number_format::Write(out, value, coordinate_format);
+  }
+
   std::ostream &out;
   int indent_step = 0;
   int indent = 0;
+  number_format::FloatFormat coordinate_format;
 };
 
-/*
- * Абстрактный базовый класс Object служит для унифицированного хранения
- * конкретных тегов SVG-документа
- * Реализует паттерн "Шаблонный метод" для вывода содержимого тега
- */
-class Object {
- public:
-  void Render(const RenderContext &context) const;
-  virtual ~Object() = default;
-
- private:
-  virtual void RenderObject(const RenderContext &context) const = 0;
-};
+class Document;
 
 template<typename Owner>
 class PathProps {
@@ -167,7 +172,9 @@ class PathProps {
       out << "\""sv;
     }
     if (stroke_width_.has_value()) {
-      out << " stroke-width=\""sv << *stroke_width_ << "\""sv;
+      out << " stroke-width=\""sv;
+      number_format::Write(out, *stroke_width_);
+      out << "\""sv;
     }
     if (stroke_line_cap_.has_value()) {
       out << " stroke-linecap=\""sv << *stroke_line_cap_ << "\""sv;
@@ -177,6 +184,17 @@ class PathProps {
     }
   }
  private:
+  friend class Document;
+
+  // Есть ли цвет-строка, не поместившаяся во внутренний буфер std::string
+  bool HasHeapColors() const {
+    const auto on_heap = [](const std::optional<Color> &color) {
+      const auto *name = color ? std::get_if<std::string>(&*color) : nullptr;
+      return name != nullptr && name->capacity() > std::string().capacity();
+    };
+    return on_heap(fill_color_) || on_heap(stroke_color_);
+  }
+
   Owner &AsOwner() {
     // static_cast безопасно преобразует *this к Owner&,
     // если класс Owner — наследник PathProps
@@ -194,13 +212,15 @@ class PathProps {
  * https://developer.mozilla.org/en-US/docs/Web/SVG/Element/circle
  */
 class Circle final
-    : public Object, public PathProps<Circle> {
+    : public PathProps<Circle> {
  public:
   Circle &SetCenter(Point center);
   Circle &SetRadius(double radius);
 
  private:
-  void RenderObject(const RenderContext &context) const override;
+  friend class Document;
+
+  void RenderObject(const RenderContext &context) const;
 
   Point center_;
   double radius_ = 1.0;
@@ -211,14 +231,27 @@ class Circle final
  * https://developer.mozilla.org/en-US/docs/Web/SVG/Element/polyline
  */
 class Polyline final
-    : public Object, public PathProps<Polyline> {
+    : public PathProps<Polyline> {
  public:
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  Polyline() = default;
+  Polyline(const Polyline &other) = default;
+  Polyline(Polyline &&other) = default;
+  // Копия, вершины которой размещаются через allocator, например в пуле документа
+  Polyline(Polyline &&other, const allocator_type &allocator)
+      : PathProps<Polyline>(other)
+      , points_(std::move(other.points_), allocator) {
+  }
+
   // Добавляет очередную вершину к ломаной линии
   Polyline &AddPoint(Point point);
 
  private:
-  void RenderObject(const RenderContext &context) const override;
-  std::vector<Point> points_;
+  friend class Document;
+
+  void RenderObject(const RenderContext &context) const;
+  std::pmr::vector<Point> points_;
 };
 
 /*
@@ -226,8 +259,24 @@ class Polyline final
  * https://developer.mozilla.org/en-US/docs/Web/SVG/Element/text
  */
 class Text final
-    : public Object, public PathProps<Text> {
+    : public PathProps<Text> {
  public:
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  Text() = default;
+  Text(const Text &other) = default;
+  Text(Text &&other) = default;
+  // Копия, строки которой размещаются через allocator, например в пуле документа
+  Text(Text &&other, const allocator_type &allocator)
+      : PathProps<Text>(other)
+      , position_(other.position_)
+      , offset_(other.offset_)
+      , font_size_(other.font_size_)
+      , font_weight_(std::move(other.font_weight_), allocator)
+      , font_family_(std::move(other.font_family_), allocator)
+      , data_(std::move(other.data_), allocator) {
+  }
+
   // Задаёт координаты опорной точки (атрибуты x и y)
   Text &SetPosition(Point pos);
 
@@ -247,41 +296,132 @@ class Text final
   Text &SetData(std::string data);
 
  private:
-  void EscapeTextData(const RenderContext &context, const std::string &data) const;
-  void RenderObject(const RenderContext &context) const override;
+  friend class Document;
+
+  void EscapeTextData(const RenderContext &context, std::string_view data) const;
+  void RenderObject(const RenderContext &context) const;
 
   Point position_ = {0.0, 0.0};
   Point offset_ = {0.0, 0.0};
   uint32_t font_size_ = 1;
-  std::string font_weight_ = "";
-  std::string font_family_ = "";
-  std::string data_ = "";
+  std::pmr::string font_weight_;
+  std::pmr::string font_family_;
+  std::pmr::string data_;
 };
 
-class ObjectContainer {
+/*
+ * Документ хранит элементы по значению в виде std::variant фиксированными блоками,
+ * а блоки, вершины ломаных и строки текстов — в пуле, который освобождается целиком.
+ * Поэтому добавление элемента обычно не выделяет память, а вывод не использует виртуальные вызовы
+ */
+class Document {
  public:
+  using Element = std::variant<Circle, Polyline, Text>;
+
+  Document();
+  Document(const Document &) = delete;
+  Document &operator=(const Document &) = delete;
+  Document(Document &&other) noexcept;
+  Document &operator=(Document &&other) noexcept;
+  ~Document();
+
+  // Добавляют в svg-документ круг, ломаную или текст, элемент перемещается прямо в блок пула
+  void Add(Circle circle);
+  void Add(Polyline polyline);
+  void Add(Text text);
+
+  size_t Size() const {
+    return size_;
+  }
+
+  // Выводит в ostream svg-представление документа
+  void Render(std::ostream &out) const;
+
+  // Задаёт профиль вывода координат и размеров фигур
+  void SetCoordinateFormat(number_format::FloatFormat coordinate_format) {
+    coordinate_format_ = coordinate_format;
+  }
+
+ private:
+  static constexpr size_t kChunkSize = 256;
+
+  // Перемещает элемент в очередную ячейку блока, вершины и строки переносятся в пул
   template<typename Obj>
-  void Add(Obj obj) {
-    AddPtr(std::make_unique<Obj>(std::move(obj)));
+  void Emplace(Obj &obj) {
+    needs_destruction_ = needs_destruction_ || obj.HasHeapColors();
+    Element *slot = AllocateSlot();
+    if constexpr (std::is_same_v<Obj, Circle>) {
+      new(slot) Element(std::in_place_type<Circle>, std::move(obj));
+    } else {
+      new(slot) Element(std::in_place_type<Obj>, std::move(obj), typename Obj::allocator_type(pool_.get()));
+    }
+    ++size_;
   }
-  virtual void AddPtr(std::unique_ptr<Object> &&ptr) = 0;
 
- protected:
-  virtual ~ObjectContainer() = default;
+  Element *AllocateSlot();
+  void Clear();
+
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> pool_;
+  std::vector<Element *> chunks_;
+  size_t size_ = 0;
+  // Элементы владеют памятью вне пула, и их деструкторы нужно вызвать
+  bool needs_destruction_ = false;
+  number_format::FloatFormat coordinate_format_;
 };
 
-class Document
-    : public ObjectContainer {
+/*
+ * Атрибуты заливки и обводки для Emitter, выводятся в том же порядке, что и PathProps.
+ * Цвета не копируются: вызывающий гарантирует, что они живут до конца вывода элемента
+ */
+struct PathStyle {
+  const Color *fill_color = nullptr;
+  const Color *stroke_color = nullptr;
+  std::optional<double> stroke_width;
+  std::optional<StrokeLineCap> stroke_line_cap;
+  std::optional<StrokeLineJoin> stroke_line_join;
+};
+
+// Параметры шрифта элемента <text>, пустые font_family и font_weight не выводятся
+struct TextStyle {
+  Point offset;
+  uint32_t font_size = 1;
+  std::string_view font_family;
+  std::string_view font_weight;
+};
+
+/*
+ * Потоковый вывод SVG-документа сразу в строку, без дерева объектов.
+ * Вывод совпадает с Document::Render для тех же элементов в том же порядке,
+ * но не выделяет память на каждый элемент и не использует виртуальные вызовы
+ */
+class Emitter {
  public:
-  // Добавляет в svg-документ объект-наследник svg::Object
-  void AddPtr(std::unique_ptr<Object> &&ptr) override;
+  explicit Emitter(std::string &out, number_format::FloatFormat coordinate_format = {})
+      : out_(out)
+      , coordinate_format_(coordinate_format) {
+  }
 
-  // Выводит в ostream svg-представление документа
-  void Render(std::ostream &out) const;
+  void StartDocument();
+  void EndDocument();
+
+  void AddCircle(Point center, double radius, const PathStyle &style);
+
+  // Вершины ломаной передаются через AddPoint между StartPolyline и EndPolyline
+  void StartPolyline();
+  void AddPoint(Point point);
+  void EndPolyline(const PathStyle &style);
+
+  void AddText(Point position, const TextStyle &text_style, const PathStyle &style, std::string_view data);
 
-  // Прочие методы и данные, необходимые для реализации класса Document
  private:
-  std::vector<std::unique_ptr<Object>> objects_;
+  void AppendCoordinate(double value);
+  void AppendAttrs(const PathStyle &style);
+  void AppendColor(const Color &color);
+  void AppendEscapedText(std::string_view data);
+
+  std::string &out_;
+  number_format::FloatFormat coordinate_format_;
+  bool first_point_ = true;
 };
 
-}  // namespace svg
\ No newline at end of file
+}  // namespace svg
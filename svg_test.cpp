@@ -0,0 +1,134 @@
+#include "svg.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/*
+ * Проверка совпадения вывода: большой документ из кругов, ломаных и текстов
+ * выводится через Document::Render и через Emitter, результаты должны совпасть побайтно.
+ * Документ занимает много блоков пула и перемещается перед выводом
+ */
+namespace
+  {
+    using namespace std::literals;
+    using namespace svg;
+
+    constexpr size_t kElementCount = 100000;
+
+    // Строковые цвета длиннее буфера std::string заставляют Document вызывать деструкторы элементов
+    const Color kRed{"red"s};
+    const Color kLongColor{"lightgoldenrodyellow"s};
+    const Color kRgba{Rgba{1, 2, 3, 0.5}};
+    const Color kRgb{Rgb{255, 16, 0}};
+
+    std::string TextData(size_t i) {
+      return "a<b & \"c\" 'd' text longer than the small string buffer "s + std::to_string(i);
+    }
+
+    void FillDocument(Document &doc) {
+      for (size_t i = 0; i < kElementCount; ++i) {
+        const double x = static_cast<double>(i) * 0.37;
+        switch (i % 3) {
+          case 0: {
+            Circle circle;
+            circle.SetCenter({x, -2.5}).SetRadius(3).SetFillColor(kRed);
+            doc.Add(circle);
+            break;
+          }
+          case 1: {
+            Polyline polyline;
+            for (size_t j = 0; j < i % 7; ++j) {
+              polyline.AddPoint({x, static_cast<double>(j)});
+            }
+            polyline.SetStrokeColor(kRgba).SetStrokeWidth(2.25)
+                .SetStrokeLineCap(StrokeLineCap::ROUND).SetStrokeLineJoin(StrokeLineJoin::ROUND);
+            doc.Add(std::move(polyline));
+            break;
+          }
+          default: {
+            Text text;
+            text.SetPosition({x, 2}).SetOffset({3, -4}).SetFontSize(12).SetFontFamily("Verdana"s)
+                .SetFontWeight(i % 2 == 0 ? "bold"s : ""s).SetData(TextData(i));
+            text.SetFillColor(i % 5 == 0 ? kLongColor : kRgb).SetStrokeColor(kRed);
+            doc.Add(std::move(text));
+            break;
+          }
+        }
+      }
+    }
+
+    void FillEmitter(Emitter &emitter) {
+      emitter.StartDocument();
+      for (size_t i = 0; i < kElementCount; ++i) {
+        const double x = static_cast<double>(i) * 0.37;
+        PathStyle style;
+        switch (i % 3) {
+          case 0: {
+            style.fill_color = &kRed;
+            emitter.AddCircle({x, -2.5}, 3, style);
+            break;
+          }
+          case 1: {
+            emitter.StartPolyline();
+            for (size_t j = 0; j < i % 7; ++j) {
+              emitter.AddPoint({x, static_cast<double>(j)});
+            }
+            style.stroke_color = &kRgba;
+            style.stroke_width = 2.25;
+            style.stroke_line_cap = StrokeLineCap::ROUND;
+            style.stroke_line_join = StrokeLineJoin::ROUND;
+            emitter.EndPolyline(style);
+            break;
+          }
+          default: {
+            TextStyle text_style;
+            text_style.offset = {3, -4};
+            text_style.font_size = 12;
+            text_style.font_family = "Verdana"sv;
+            text_style.font_weight = i % 2 == 0 ? "bold"sv : ""sv;
+            style.fill_color = i % 5 == 0 ? &kLongColor : &kRgb;
+            style.stroke_color = &kRed;
+            emitter.AddText({x, 2}, text_style, style, TextData(i));
+            break;
+          }
+        }
+      }
+      emitter.EndDocument();
+    }
+
+    bool Check(const std::string &name, const std::string &actual, const std::string &expected) {
+      if (actual == expected) {
+        return true;
+      }
+      const auto diff = std::mismatch(actual.begin(), actual.end(), expected.begin(), expected.end());
+      std::cerr << name << ": output differs at byte "sv << (diff.first - actual.begin()) << '\n';
+      return false;
+    }
+  }
+
+int main() {
+  bool ok = true;
+  for (const auto format: {number_format::FloatFormat{}, number_format::FloatFormat{number_format::FloatFormat::kShortest}}) {
+    Document doc;
+    doc.SetCoordinateFormat(format);
+    FillDocument(doc);
+    if (doc.Size() != kElementCount) {
+      std::cerr << "unexpected document size: "sv << doc.Size() << '\n';
+      return 1;
+    }
+    Document moved;
+    moved = std::move(doc);
+
+    std::ostringstream rendered;
+    moved.Render(rendered);
+
+    std::string expected;
+    Emitter emitter(expected, format);
+    FillEmitter(emitter);
+
+    ok = Check("Document::Render"s, rendered.str(), expected) && ok;
+  }
+  return ok ? 0 : 1;
+}
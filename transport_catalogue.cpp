@@ -1,22 +1,98 @@
 #include "transport_catalogue.h"
 #include "geo.h"
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 #include <unordered_set>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace transcat
   {
+    namespace
+      {
+        /*
+         * Пересекает битовые множества маршрутов сразу по 4 (AVX2) или 2 (SSE2) слова в регистре,
+         * пустые полосы пропускаются одной проверкой, остаток досчитывается поэлементно.
+         * Для каждого непустого слова пересечения вызывается on_word(индекс слова, биты)
+         */
+        template<typename OnWord>
+        void ForEachCommonWord(const uint64_t *lhs, const uint64_t *rhs, size_t words, OnWord on_word) {
+          size_t word = 0;
+#if defined(__AVX2__)
+          for (; word + 4 <= words; word += 4) {
+            const __m256i common = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + word)),
+                                                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + word)));
+            if (_mm256_testz_si256(common, common)) {
+              continue;
+            }
+            alignas(32) uint64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), common);
+            for (size_t lane = 0; lane < 4; ++lane) {
+              if (lanes[lane] != 0) {
+                on_word(word + lane, lanes[lane]);
+              }
+            }
+          }
+#elif defined(__SSE2__)
+          const __m128i zero = _mm_setzero_si128();
+          for (; word + 2 <= words; word += 2) {
+            const __m128i common = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lhs + word)),
+                                                 _mm_loadu_si128(reinterpret_cast<const __m128i *>(rhs + word)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(common, zero)) == 0xFFFF) {
+              continue;
+            }
+            alignas(16) uint64_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), common);
+            for (size_t lane = 0; lane < 2; ++lane) {
+              if (lanes[lane] != 0) {
+                on_word(word + lane, lanes[lane]);
+              }
+            }
+          }
+#endif
+          for (; word < words; ++word) {
+            if (const uint64_t common = lhs[word] & rhs[word]; common != 0) {
+              on_word(word, common);
+            }
+          }
+        }
+      }
+
     void TransportCatalogue::AddPassingBus(const Bus *const bus) {
       if (bus == nullptr) {
         return;
       }
+      const size_t word = bus->id / 64;
+      const uint64_t bit = uint64_t{1} << (bus->id % 64);
       for (const auto *stop : bus->route.stops) {
         stop_passing_buses_[stop].insert(bus->name);
+        if (stop_passing_buses_bits_.size() <= stop->id) {
+          stop_passing_buses_bits_.resize(stop->id + 1);
+        }
+        auto &bits = stop_passing_buses_bits_[stop->id];
+        if (bits.empty()) {
+          // Первый маршрут через остановку
+          routed_stop_lats_.push_back(stop->coords.lat);
+          routed_stop_lngs_.push_back(stop->coords.lng);
+          const std::lock_guard guard(routed_bounds_mutex_);
+          routed_bounds_valid_ = false;
+        }
+        if (bits.size() <= word) {
+          bits.resize(word + 1, 0);
+        }
+        bits[word] |= bit;
       }
     }
 
     const Stop *TransportCatalogue::AddNewStop(const Stop &stop) {
-      const auto &new_stop = stops_list_.emplace_back(stop);
+      auto &new_stop = stops_list_.emplace_back(stop);
+      new_stop.id = stops_list_.size() - 1;
       stops_dict_.insert({new_stop.name, &new_stop});
 
       return &new_stop;
@@ -24,11 +100,28 @@ namespace transcat
 
     Bus *TransportCatalogue::AddNewBus(const Bus &bus) {
       auto &new_bus = buses_list_.emplace_back(bus);
+      new_bus.id = buses_list_.size() - 1;
       buses_dict_.insert({new_bus.name, &new_bus});
 
       return &new_bus;
     }
 
+    std::string_view TransportCatalogue::StoreName(std::string_view name) {
+      return names_.emplace_back(name);
+    }
+
+    void TransportCatalogue::KeepAlive(std::shared_ptr<const void> storage) {
+      external_storage_.push_back(std::move(storage));
+    }
+
+    const Stop *TransportCatalogue::GetStop(size_t id) const {
+      return &stops_list_.at(id);
+    }
+
+    const Bus *TransportCatalogue::GetBus(size_t id) const {
+      return &buses_list_.at(id);
+    }
+
     std::pair<DistancesBetweenStops::iterator , bool> TransportCatalogue::InsertStopsDistance(const Stop *stop_from, const Stop *stop_to, int dist) {
       return distance_between_stops_.insert({{stop_from, stop_to}, dist});
     }
@@ -144,6 +237,33 @@ namespace transcat
       return buses_info;
     }
 
+    BusesInfo TransportCatalogue::ComputeDirectBuses(const std::string_view &from_name,
+                                                     const std::string_view &to_name) const {
+      BusesInfo buses_info;
+      const Stop *const from = FindStop(from_name);
+      const Stop *const to = FindStop(to_name);
+      if (from == nullptr || to == nullptr) {
+        buses_info.not_found = true;
+        return buses_info;
+      }
+      buses_info.not_found = false;
+      if (from->id >= stop_passing_buses_bits_.size() || to->id >= stop_passing_buses_bits_.size()) {
+        return buses_info;
+      }
+      const auto &from_bits = stop_passing_buses_bits_[from->id];
+      const auto &to_bits = stop_passing_buses_bits_[to->id];
+      const size_t words = std::min(from_bits.size(), to_bits.size());
+      ForEachCommonWord(from_bits.data(), to_bits.data(), words, [&](size_t word, uint64_t common) {
+        for (; common != 0; common &= common - 1) {
+          const Bus &bus = buses_list_[word * 64 + __builtin_ctzll(common)];
+          if (detail::IsDirectRoute(bus.route, from, to)) {
+            buses_info.buses.insert(bus.name);
+          }
+        }
+      });
+      return buses_info;
+    }
+
     const Stop *TransportCatalogue::FindStop(const std::string_view &stop_name) const {
       const auto stop_it = stops_dict_.find(stop_name);
       if (stop_it == stops_dict_.end()) {
@@ -166,7 +286,7 @@ namespace transcat
       const auto bus_it = buses_dict_.find(bus_name);
       if (bus_it == buses_dict_.end()) {
         Bus bus;
-        bus.name = std::string(bus_name);
+        bus.name = StoreName(bus_name);
         return AddNewBus(bus);
       } else {
         return const_cast<Bus *>(bus_it->second);
@@ -185,13 +305,37 @@ namespace transcat
       return stop_passing_buses_;
     }
 
+    std::optional<geo::Bounds> TransportCatalogue::GetRoutedStopsBounds() const {
+      const std::lock_guard guard(routed_bounds_mutex_);
+      if (!routed_bounds_valid_) {
+        routed_bounds_ = geo::ComputeBounds(routed_stop_lats_.data(), routed_stop_lngs_.data(), routed_stop_lats_.size());
+        routed_bounds_valid_ = true;
+      }
+      return routed_bounds_;
+    }
+
     const DistancesBetweenStops &TransportCatalogue::GetDistanceBetweenStops() const {
       return distance_between_stops_;
     }
 
     namespace detail
       {
-
+        /*
+         * Некольцевой маршрут проходит в обе стороны, поэтому порядок остановок важен только для кольцевого.
+         * Если from == to, прямым считается любой маршрут через остановку: поездка нулевой длины
+         * не требует пересадок, и запрос отвечает списком маршрутов остановки, как запрос Stop
+         */
+        bool IsDirectRoute(const Route &route, const Stop *const from, const Stop *const to) {
+          const auto &stops = route.stops;
+          const auto from_it = std::find(stops.begin(), stops.end(), from);
+          if (from_it == stops.end()) {
+            return false;
+          }
+          if (!route.is_roundtrip || from == to) {
+            return std::find(stops.begin(), stops.end(), to) != stops.end();
+          }
+          return std::find(std::next(from_it), stops.end(), to) != stops.end();
+        }
 
         double ComputeFactGeoLength(const Stop* const prev_stop,
                                     const Stop* const next_stop,
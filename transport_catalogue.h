@@ -3,7 +3,12 @@
 #include "domain.h"
 
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <vector>
 
 namespace transcat
   {
@@ -12,12 +17,20 @@ namespace transcat
       explicit TransportCatalogue() = default;
 
       void AddPassingBus(const Bus *const bus);
+      // Название stop.name и bus.name не копируется и должно жить не меньше справочника
       const Stop *AddNewStop(const Stop &stop);
       Bus *AddNewBus(const Bus &bus);
+      // Копирует название в справочник, копия живёт, пока жив справочник
+      std::string_view StoreName(std::string_view name);
+      // Продлевает жизнь памяти, на которую указывают названия, например отображённого файла базы
+      void KeepAlive(std::shared_ptr<const void> storage);
+      const Stop *GetStop(size_t id) const;
+      const Bus *GetBus(size_t id) const;
       std::pair<DistancesBetweenStops::iterator , bool> InsertStopsDistance(const Stop *stop_from, const Stop *stop_to, int dist);
 
       RouteInfo ComputeRouteInfo(const std::string_view &bus_name) const;
       BusesInfo ComputeBusInfo(const std::string_view &stop_name) const;
+      BusesInfo ComputeDirectBuses(const std::string_view &from_name, const std::string_view &to_name) const;
       const Stop *FindStop(const std::string_view &stop_name) const;
       const Bus *FindBus(const std::string_view &bus_name) const;
       Bus *FindCreateBus(const std::string_view &bus_name);
@@ -25,18 +38,32 @@ namespace transcat
       const Stops &GetAllStops() const;
       const PassingBuses &GetAllPassingBuses() const;
       const DistancesBetweenStops &GetDistanceBetweenStops() const;
+      // Границы остановок, через которые проходят маршруты, nullopt — таких остановок нет.
+      // Вычисляются при первом обращении и заново после добавления маршрута
+      std::optional<geo::Bounds> GetRoutedStopsBounds() const;
      private:
+      std::deque<std::string> names_;
+      std::vector<std::shared_ptr<const void>> external_storage_;
       std::deque<Stop> stops_list_;
       std::deque<Bus> buses_list_;
       Stops stops_dict_;
       Buses buses_dict_;
       PassingBuses stop_passing_buses_;
+      std::vector<PassingBusesBits> stop_passing_buses_bits_;
       DistancesBetweenStops distance_between_stops_;
+      // Координаты остановок с маршрутами в виде структуры массивов для векторного поиска границ
+      std::vector<double> routed_stop_lats_;
+      std::vector<double> routed_stop_lngs_;
+      mutable std::mutex routed_bounds_mutex_;
+      mutable bool routed_bounds_valid_ = false;
+      mutable std::optional<geo::Bounds> routed_bounds_;
 
     };
 
     namespace detail
       {
+        // Можно ли доехать маршрутом от from до to без пересадок, при from == to — проходит ли он через остановку
+        bool IsDirectRoute(const Route &route, const Stop *const from, const Stop *const to);
         double ComputeFactGeoLength(const Stop* const prev_stop,
                                     const Stop* const next_stop,
                                     const DistancesBetweenStops &distance_between_stops);
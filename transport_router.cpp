@@ -8,8 +8,7 @@
 namespace transcat
   {
     TransportRouter::TransportRouter(const transcat::TransportCatalogue &tc)
-        : transport_catalogue_(tc)
-        , graph_(tc.GetAllStops().size()) {
+        : transport_catalogue_(tc) {
 
     }
 
@@ -22,6 +21,14 @@ namespace transcat
       return router_ != nullptr;
     }
 
+    void TransportRouter::EnsureInitialized(const RoutingSettings &routing_settings) {
+      std::call_once(initialize_flag_, [this, &routing_settings] {
+        if (!IsInitialized()) {
+          Initialize(routing_settings);
+        }
+      });
+    }
+
     GrathRouteInfo TransportRouter::BuildRoute(const std::string &from, const std::string &to) const {
       GrathRouteInfo route_info{};
 
@@ -38,14 +45,16 @@ namespace transcat
         const auto &edges = router_result->edges;
         const auto size = edges.size();
         for (size_t i = 0; i < size; ++i) {
-          const auto edge = graph_.GetEdge(edges[i]);
+          const auto &edge = graph_.GetEdge(edges[i]);
+          const std::string_view bus_name = edge.bus == graph::kNoBus ? std::string_view{}
+                                                                      : transport_catalogue_.GetBus(edge.bus)->name;
           route_info.items.push_back({
                                          static_cast<double>(routing_settings_.bus_wait_time_minutes), ItemType::WAIT
-                                         , edge.stop_name, 0
+                                         , transport_catalogue_.GetStop(edge.stop)->name, 0
                                      });
           route_info.items.push_back({
                                          edge.weight - routing_settings_.bus_wait_time_minutes, ItemType::BUS
-                                         , edge.bus_name, edge.span_count
+                                         , bus_name, edge.span_count
                                      });
         }
       } else {
@@ -54,7 +63,7 @@ namespace transcat
       return route_info;
     }
 
-    graph::DirectedWeightedGraph<Minutes> &TransportRouter::GetGraph() {
+    const graph::DirectedWeightedGraph<Minutes> &TransportRouter::GetGraph() const {
       return graph_;
     }
 
@@ -65,12 +74,12 @@ namespace transcat
     void TransportRouter::CreateGraph() {
       constexpr double kMetreInMinuteCoefficient = 1000 * 1.0 / 60;
 
+      std::vector<graph::Edge<Minutes>> edges;
       {
-        size_t id = 0;
+        uint32_t id = 0;
         for (const auto &[name, stop]: transport_catalogue_.GetAllStops()) {
           reverse_data_for_graph_.insert({stop->name, id});
-          std::string_view sv;
-          graph_.AddEdge({id, id, 0.0, sv, name, 0});
+          edges.push_back({id, id, 0.0, graph::kNoBus, static_cast<uint32_t>(stop->id), 0});
           ++id;
         }
       }
@@ -84,7 +93,7 @@ namespace transcat
         const auto route_size = bus->route.stops.size();
         const auto &stops = bus->route.stops;
         for (size_t i = 0; i < route_size - 1; ++i) {
-          size_t span_count = 0;
+          uint32_t span_count = 0;
           for (size_t j = i + 1; j < route_size; ++j) {
             double distance = 0;
             for (size_t k = i + 1; k <= j; ++k) {
@@ -92,18 +101,19 @@ namespace transcat
             }
             const double time = distance / speed;
             const auto stop_it_from = reverse_data_for_graph_.find(stops[i]->name);
-            const graph::VertexId from = stop_it_from->second;
+            const auto from = static_cast<uint32_t>(stop_it_from->second);
             const auto stop_it_to = reverse_data_for_graph_.find(stops[j]->name);
-            const graph::VertexId to = stop_it_to->second;
+            const auto to = static_cast<uint32_t>(stop_it_to->second);
             std::lock_guard<std::mutex> guard(mx);
-            graph_.AddEdge({from, to, wait_time + time, bus->name, stops[i]->name, ++span_count});
+            edges.push_back({from, to, wait_time + time, static_cast<uint32_t>(bus->id),
+                             static_cast<uint32_t>(stops[i]->id), ++span_count});
           }
         }
         if (!bus->route.is_roundtrip) {
           for (size_t i = route_size - 1; i > 0; --i) {
             const auto stop_it_from = reverse_data_for_graph_.find(stops[i]->name);
-            const graph::VertexId from = stop_it_from->second;
-            size_t span_count = 0;
+            const auto from = static_cast<uint32_t>(stop_it_from->second);
+            uint32_t span_count = 0;
             for (int j = i - 1; j >= 0; --j) {
               double distance = 0;
               for (int k = i; k > j; --k) {
@@ -111,13 +121,15 @@ namespace transcat
               }
               const double time = distance / speed;
               const auto stop_it_to = reverse_data_for_graph_.find(stops[j]->name);
-              const graph::VertexId to = stop_it_to->second;
+              const auto to = static_cast<uint32_t>(stop_it_to->second);
               std::lock_guard<std::mutex> guard(mx);
-              graph_.AddEdge({from, to, wait_time + time, bus->name, stops[i]->name, ++span_count});
+              edges.push_back({from, to, wait_time + time, static_cast<uint32_t>(bus->id),
+                               static_cast<uint32_t>(stops[i]->id), ++span_count});
             }
           }
         }
       });
+      graph_ = graph::DirectedWeightedGraph<Minutes>(transport_catalogue_.GetAllStops().size(), std::move(edges));
       graph::Router<Minutes> router(graph_);
       router_ = std::make_unique<graph::Router<Minutes>>(router);
     }
@@ -5,6 +5,7 @@
 #include "transport_catalogue.h"
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -37,8 +38,14 @@ namespace transcat
       explicit TransportRouter(const transcat::TransportCatalogue &tc);
       void Initialize(const RoutingSettings &routing_settings);
       bool IsInitialized() const;
+      // Потокобезопасно строит граф при первом обращении, если маршрутизатор ещё не загружен из базы
+      void EnsureInitialized(const RoutingSettings &routing_settings);
       GrathRouteInfo BuildRoute(const std::string &from, const std::string &to) const;
-      graph::DirectedWeightedGraph<Minutes> &GetGraph();
+      const graph::DirectedWeightedGraph<Minutes> &GetGraph() const;
+      // Граф задаётся до маршрутизатора: Router хранит ссылку на него
+      void SetGraph(graph::DirectedWeightedGraph<Minutes> graph) {
+        graph_ = std::move(graph);
+      }
       std::shared_ptr<graph::Router<Minutes>> GetRouter() const;
       void SetRouter(const graph::Router<Minutes> &router) {
         router_ = std::make_shared<graph::Router<Minutes>>(router);
@@ -62,5 +69,7 @@ namespace transcat
       std::unordered_map<std::string_view, size_t> reverse_data_for_graph_;
       graph::DirectedWeightedGraph<Minutes> graph_;
       std::shared_ptr<graph::Router<Minutes>> router_;
+      // Из-за once_flag маршрутизатор не копируется, он создаётся сразу в std::make_shared
+      std::once_flag initialize_flag_;
     };
   }
\ No newline at end of file